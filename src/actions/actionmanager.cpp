@@ -22,6 +22,7 @@ ActionManager::ActionManager(QMainWindow *mainWindow, CommandManager *commandMan
     , m_zoomOutAct(nullptr)
     , m_normalSizeAct(nullptr)
     , m_fitToWindowAct(nullptr)
+    , m_colorLutPreviewAct(nullptr)
 {
 }
 
@@ -210,7 +211,14 @@ void ActionManager::createViewActions()
     m_fitToWindowAct->setIcon(QIcon(":/icons/icons/toolbar/fit_to_window.svg"));
     connect(m_fitToWindowAct, &QAction::triggered, mainWin, &MainWindow::fitToWindow);
 
-    m_viewActions << m_zoomInAct << m_zoomOutAct << m_normalSizeAct << m_fitToWindowAct;
+    m_colorLutPreviewAct = new QAction(tr("Fast &Color Preview (3D LUT)"), m_mainWindow);
+    m_colorLutPreviewAct->setStatusTip(tr("Preview adjustments through a baked 3D LUT for constant-time sliders"));
+    m_colorLutPreviewAct->setCheckable(true);
+    m_colorLutPreviewAct->setChecked(SettingsManager::instance()->colorLutPreview());
+    connect(m_colorLutPreviewAct, &QAction::triggered, mainWin, &MainWindow::toggleColorLutPreview);
+
+    m_viewActions << m_zoomInAct << m_zoomOutAct << m_normalSizeAct << m_fitToWindowAct
+                  << m_colorLutPreviewAct;
 }
 
 void ActionManager::createFilterActions()
@@ -229,6 +237,10 @@ void ActionManager::createFilterActions()
     QAction *vignetteAct = new QAction(tr("&Vignette"), m_mainWindow);
     connect(vignetteAct, &QAction::triggered, mainWin, &MainWindow::applyVignette);
 
+    QAction *colorLutAct = new QAction(tr("Apply &LUT (.cube)..."), m_mainWindow);
+    colorLutAct->setStatusTip(tr("Apply a 3D color lookup table from a .cube file"));
+    connect(colorLutAct, &QAction::triggered, mainWin, &MainWindow::applyColorLut);
+
     QAction *sharpenAct = new QAction(tr("S&harpen"), m_mainWindow);
     sharpenAct->setIcon(QIcon(":/icons/icons/toolbar/sharpen.svg"));
     connect(sharpenAct, &QAction::triggered, mainWin, &MainWindow::applySharpen);
@@ -240,7 +252,12 @@ void ActionManager::createFilterActions()
     QAction *edgeDetectionAct = new QAction(tr("&Edge Detection"), m_mainWindow);
     connect(edgeDetectionAct, &QAction::triggered, mainWin, &MainWindow::applyEdgeDetection);
 
-    m_filterActions << blackWhiteAct << sepiaAct << vignetteAct << sharpenAct << blurAct << edgeDetectionAct;
+    QAction *customKernelAct = new QAction(tr("C&ustom Kernel..."), m_mainWindow);
+    customKernelAct->setStatusTip(tr("Convolve the image with your own kernel weights"));
+    connect(customKernelAct, &QAction::triggered, mainWin, &MainWindow::applyCustomKernel);
+
+    m_filterActions << blackWhiteAct << sepiaAct << vignetteAct << colorLutAct
+                    << sharpenAct << blurAct << edgeDetectionAct << customKernelAct;
 }
 
 void ActionManager::createTransformActions()
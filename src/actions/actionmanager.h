@@ -50,6 +50,7 @@ public:
     QAction* zoomOutAction() const { return m_zoomOutAct; }
     QAction* normalSizeAction() const { return m_normalSizeAct; }
     QAction* fitToWindowAction() const { return m_fitToWindowAct; }
+    QAction* colorLutPreviewAction() const { return m_colorLutPreviewAct; }
     QAction* aiEnhanceAction() const { return m_aiEnhanceAct; }
     QAction* aiSettingsAction() const { return m_aiSettingsAct; }
 
@@ -78,6 +79,7 @@ private:
     QAction *m_zoomOutAct;
     QAction *m_normalSizeAct;
     QAction *m_fitToWindowAct;
+    QAction *m_colorLutPreviewAct;
 
     // Action lists for menu/toolbar creation
     QList<QAction*> m_fileActions;
@@ -1,6 +1,5 @@
 #include "commandfactory.h"
 #include <QObject>
-#include <cmath>
 
 // Adjustment commands
 BrightnessCommand* CommandFactory::createBrightnessCommand(QImage *target, int value, QUndoCommand *parent)
@@ -60,6 +59,17 @@ BlurCommand* CommandFactory::createBlurCommand(QImage *target, int radius, QUndo
     return new BlurCommand(target, radius, parent);
 }
 
+ConvolutionCommand* CommandFactory::createConvolutionCommand(QImage *target, const ConvolutionKernel &kernel,
+                                                             Convolution::BorderMode border, QUndoCommand *parent)
+{
+    return new ConvolutionCommand(target, kernel, border, parent);
+}
+
+ColorLutCommand* CommandFactory::createColorLutCommand(QImage *target, const ColorLut3D &lut, QUndoCommand *parent)
+{
+    return new ColorLutCommand(target, lut, parent);
+}
+
 // Transformation commands
 RotateCommand* CommandFactory::createRotateCommand(QImage *target, int angle, QUndoCommand *parent)
 {
@@ -98,35 +108,14 @@ CompoundAdjustmentCommand* CommandFactory::createCompoundAdjustmentCommand(QImag
                                                                           const QString &text)
 {
     QString commandText = text.isEmpty() ? QObject::tr("Apply Adjustments") : text;
-    CompoundAdjustmentCommand *compound = new CompoundAdjustmentCommand(target, commandText);
-
-    // Add individual adjustment commands as children only if they have non-default values
-    if (params.brightness != 0)
-        new BrightnessCommand(target, params.brightness, compound);
-
-    if (params.contrast != 0)
-        new ContrastCommand(target, params.contrast, compound);
 
-    if (params.saturation != 0)
-        new SaturationCommand(target, params.saturation, compound);
-
-    if (params.hue != 0)
-        new HueCommand(target, params.hue, compound);
-
-    if (std::abs(params.gamma - 1.0) > 0.01)
-        new GammaCommand(target, params.gamma, compound);
-
-    if (params.temperature != 0)
-        new ColorTemperatureCommand(target, params.temperature, compound);
-
-    if (params.exposure != 0)
-        new ExposureCommand(target, params.exposure, compound);
-
-    if (params.shadows != 0)
-        new ShadowsCommand(target, params.shadows, compound);
-
-    if (params.highlights != 0)
-        new HighlightsCommand(target, params.highlights, compound);
+    // One command, one fused pass over the image for all active stages
+    return new CompoundAdjustmentCommand(target, params, commandText);
+}
 
-    return compound;
+PipelineCommand* CommandFactory::createPipelineCommand(QImage *target, const QVector<AdjustmentParameters> &passes,
+                                                      const QVector<PipelineCommand::Filter> &filters,
+                                                      const QString &text)
+{
+    return new PipelineCommand(target, passes, filters, text);
 }
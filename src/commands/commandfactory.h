@@ -44,6 +44,10 @@ public:
     // Filter commands
     static FilterCommand* createFilterCommand(QImage *target, FilterCommand::FilterType type, QUndoCommand *parent = nullptr);
     static BlurCommand* createBlurCommand(QImage *target, int radius, QUndoCommand *parent = nullptr);
+    static ConvolutionCommand* createConvolutionCommand(QImage *target, const ConvolutionKernel &kernel,
+                                                        Convolution::BorderMode border = Convolution::Clamp,
+                                                        QUndoCommand *parent = nullptr);
+    static ColorLutCommand* createColorLutCommand(QImage *target, const ColorLut3D &lut, QUndoCommand *parent = nullptr);
 
     // Transformation commands
     static RotateCommand* createRotateCommand(QImage *target, int angle, QUndoCommand *parent = nullptr);
@@ -59,6 +63,9 @@ public:
     static CompoundAdjustmentCommand* createCompoundAdjustmentCommand(QImage *target,
                                                                       const AdjustmentParameters &params,
                                                                       const QString &text = QString());
+    static PipelineCommand* createPipelineCommand(QImage *target, const QVector<AdjustmentParameters> &passes,
+                                                  const QVector<PipelineCommand::Filter> &filters,
+                                                  const QString &text);
 
 private:
     // Private constructor - this is a static factory
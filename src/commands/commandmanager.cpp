@@ -2,39 +2,305 @@
 #include "../model/imagedocument.h"
 #include "../imageprocessor.h"
 #include "../logging/logger.h"
+#include "../settings/settingsmanager.h"
+#include "../processing/parallelrows.h"
+#include "imagecommand.h"
+#include "undoscratchfile.h"
+#include <QAction>
+#include <QFutureWatcher>
 #include <QUndoCommand>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
 
 CommandManager::CommandManager(ImageDocument *document, ImageProcessor *processor, QObject *parent)
     : QObject(parent)
     , m_document(document)
     , m_processor(processor)
     , m_undoStack(new QUndoStack(this))
+    , m_memoryBudget(SettingsManager::instance()->undoMemoryBudget())
+    , m_spillWatcher(new QFutureWatcher<void>(this))
+    , m_budgetOutdated(false)
+    , m_running(nullptr)
+    , m_runningInputKey(0)
+    , m_runningMerges(false)
+    , m_pushing(false)
+    , m_watcher(new QFutureWatcher<void>(this))
 {
+    connect(m_watcher, &QFutureWatcher<void>::finished, this, &CommandManager::onCommandFinished);
+    connect(m_spillWatcher, &QFutureWatcher<void>::finished, this, &CommandManager::onSpillFinished);
+
     // Connect undo stack signals to our signals
     connect(m_undoStack, &QUndoStack::canUndoChanged, this, &CommandManager::canUndoChanged);
     connect(m_undoStack, &QUndoStack::canRedoChanged, this, &CommandManager::canRedoChanged);
-    connect(m_undoStack, &QUndoStack::indexChanged, this, &CommandManager::indexChanged);
+    connect(m_undoStack, &QUndoStack::indexChanged, this, &CommandManager::onIndexChanged);
+
+    // Commands edit the image in place, the document cannot notice on its own
+    connect(m_undoStack, &QUndoStack::indexChanged, m_document, &ImageDocument::updatePyramid);
+    connect(m_undoStack, &QUndoStack::indexChanged, this, &CommandManager::enforceMemoryBudget);
 }
 
 CommandManager::~CommandManager()
 {
     // QUndoStack is deleted automatically as a child of this object
+    cancelPendingCommands();
+    m_watcher->waitForFinished();
+    m_spillWatcher->waitForFinished();
+    delete m_running;
 }
 
 void CommandManager::executeCommand(QUndoCommand *command)
 {
     if (command) {
         LOG_DEBUG(QString("Executing command: %1").arg(command->text()));
-        m_undoStack->push(command);
-        emit commandExecuted();
+        m_pending.enqueue(command);
+        startNextCommand();
+    }
+}
+
+void CommandManager::startNextCommand()
+{
+    while (!m_running && !m_pending.isEmpty()) {
+        QUndoCommand *command = m_pending.dequeue();
+        ImageCommand *imageCommand = dynamic_cast<ImageCommand*>(command);
+        if (!imageCommand || !imageCommand->targetImage()) {
+            pushCommand(command);
+            continue;
+        }
+
+        // The worker reads a shared copy, the document detaches if it is edited meanwhile
+        QImage input = *imageCommand->targetImage();
+        m_running = imageCommand;
+        m_runningInputKey = input.cacheKey();
+
+        // An edit of the same kind as the last one is merged into it: the
+        // combined parameters run once on the input of the last command
+        const int index = m_undoStack->index();
+        ImageCommand *last = index > 0
+            ? dynamic_cast<ImageCommand*>(const_cast<QUndoCommand*>(m_undoStack->command(index - 1)))
+            : nullptr;
+        m_runningMerges = last && imageCommand->mergeWith(last);
+        if (m_runningMerges) {
+            LOG_DEBUG(QString("Merging command into the previous one: %1").arg(imageCommand->text()));
+            input = last->inputImage();
+        }
+
+        m_cancelled = std::make_shared<std::atomic<bool>>(false);
+        const std::shared_ptr<std::atomic<bool>> cancelled = m_cancelled;
+        m_watcher->setFuture(QtConcurrent::run([imageCommand, input, cancelled]() {
+            ParallelRows::CancelScope scope(cancelled.get());
+            imageCommand->prepare(input);
+        }));
     }
+    emitExecutionChanged();
+}
+
+void CommandManager::onCommandFinished()
+{
+    if (!m_running || !m_watcher->isFinished())
+        return;
+
+    ImageCommand *command = m_running;
+    m_running = nullptr;
+    if (m_cancelled->load()) {
+        LOG_DEBUG(QString("Cancelled command: %1").arg(command->text()));
+        delete command;
+    } else if (command->targetImage()->cacheKey() != m_runningInputKey) {
+        // Undone or redone while computing: run again on the current image.
+        // A merged command absorbed one that may no longer be on top, so it
+        // goes back to its own parameters first (and may merge again)
+        if (m_runningMerges) {
+            LOG_DEBUG(QString("Splitting merged command after a history change: %1").arg(command->text()));
+            command->unmerge();
+        }
+        m_pending.prepend(command);
+    } else {
+        // A merged command replaces the one it absorbed, which push() deletes once undone
+        if (m_runningMerges) {
+            m_pushing = true;
+            m_undoStack->undo();
+        }
+        pushCommand(command);
+    }
+    startNextCommand();
+}
+
+void CommandManager::pushCommand(QUndoCommand *command)
+{
+    // Cheap commands are undone by replaying the ones before them
+    const int index = m_undoStack->index();
+    ImageCommand *imageCommand = dynamic_cast<ImageCommand*>(command);
+    if (imageCommand && index > 0) {
+        imageCommand->setReplayBase(dynamic_cast<ImageCommand*>(
+            const_cast<QUndoCommand*>(m_undoStack->command(index - 1))));
+    }
+
+    m_pushing = true;
+    m_undoStack->push(command);
+    m_pushing = false;
+    emit commandExecuted();
+}
+
+void CommandManager::onIndexChanged(int index)
+{
+    // Pushes land whenever a command finishes computing; only moves through
+    // the history (undo, redo, a click in the history view) are navigation
+    if (!m_pushing)
+        emit historyNavigated();
+    emit indexChanged(index);
+}
+
+void CommandManager::finishPendingCommands()
+{
+    while (isBusy()) {
+        if (m_running) {
+            m_watcher->waitForFinished();
+            onCommandFinished();
+        } else {
+            startNextCommand();
+        }
+    }
+}
+
+void CommandManager::cancelPendingCommands()
+{
+    if (!isBusy())
+        return;
+
+    LOG_DEBUG(QString("Cancelling %1 queued commands").arg(pendingCount()));
+    qDeleteAll(m_pending);
+    m_pending.clear();
+    if (m_running)
+        m_cancelled->store(true);
+    emitExecutionChanged();
+}
+
+void CommandManager::emitExecutionChanged()
+{
+    emit executionChanged(m_running ? m_running->text() : QString(), pendingCount());
 }
 
 void CommandManager::clear()
 {
+    cancelPendingCommands();
+
     int count = m_undoStack->count();
     LOG_DEBUG(QString("Clearing undo stack (%1 commands)").arg(count));
     m_undoStack->clear();
+    emit historyMemoryChanged(0, 0);
+}
+
+void CommandManager::setMemoryBudget(qint64 bytes)
+{
+    m_memoryBudget = bytes;
+    enforceMemoryBudget();
+}
+
+void CommandManager::enforceMemoryBudget()
+{
+    // One batch compresses at a time, the next check waits for it
+    if (m_spillWatcher->isRunning()) {
+        m_budgetOutdated = true;
+        return;
+    }
+    m_budgetOutdated = false;
+
+    // Order the commands by distance from the current index: the next undo
+    // and redo come first and stay in memory, the farthest are spilled first
+    const int index = m_undoStack->index();
+    QVector<QPair<int, ImageCommand*>> commands;
+    for (int i = 0; i < m_undoStack->count(); ++i) {
+        // QUndoStack only hands out const commands; spilling does not change what they do
+        auto *command = dynamic_cast<ImageCommand*>(const_cast<QUndoCommand*>(m_undoStack->command(i)));
+        if (command)
+            commands.append({i < index ? index - 1 - i : i - index, command});
+    }
+    std::sort(commands.begin(), commands.end(), [](const auto &a, const auto &b) {
+        return a.first < b.first;
+    });
+
+    // Serializing and compressing runs on a worker; the commands being
+    // compressed count as spilled so the ones nearer stay in memory
+    QVector<std::function<void()>> jobs;
+    qint64 resident = 0;
+    qint64 spilled = 0;
+    for (const auto &entry : commands) {
+        ImageCommand *command = entry.second;
+        const qint64 bytes = command->undoBytes();
+        const bool nearest = entry.first == 0;
+        if (bytes > 0 && !nearest && resident + bytes > m_memoryBudget) {
+            std::function<void()> job = command->spillUndoData();
+            if (job)
+                jobs.append(std::move(job));
+        }
+        if (!command->isSpillPending())
+            resident += command->undoBytes();
+        spilled += command->spilledBytes();
+    }
+
+    emit historyMemoryChanged(resident, spilled);
+
+    if (!jobs.isEmpty()) {
+        m_spillWatcher->setFuture(QtConcurrent::run([jobs]() {
+            for (const auto &job : jobs)
+                job();
+        }));
+    }
+}
+
+void CommandManager::onSpillFinished()
+{
+    if (!m_scratch)
+        m_scratch = std::make_shared<UndoScratchFile>();
+
+    // Commands swapped since their job started stay in memory; commands
+    // deleted meanwhile took their job's result with them
+    for (int i = 0; i < m_undoStack->count(); ++i) {
+        auto *command = dynamic_cast<ImageCommand*>(const_cast<QUndoCommand*>(m_undoStack->command(i)));
+        if (command && command->isSpillPending() && command->completeSpill(m_scratch))
+            LOG_DEBUG(QString("Spilled undo data of \"%1\"").arg(command->text()));
+    }
+
+    // Without a history change the check would only start the failed writes again
+    if (m_budgetOutdated) {
+        enforceMemoryBudget();
+        return;
+    }
+
+    qint64 resident = 0;
+    qint64 spilled = 0;
+    for (int i = 0; i < m_undoStack->count(); ++i) {
+        if (auto *command = dynamic_cast<const ImageCommand*>(m_undoStack->command(i))) {
+            resident += command->undoBytes();
+            spilled += command->spilledBytes();
+        }
+    }
+    emit historyMemoryChanged(resident, spilled);
+}
+
+void CommandManager::undo()
+{
+    // The newest edit not pushed yet is the most recent one, undo abandons
+    // only that one: the last queued edit, or else the one computing
+    if (!m_pending.isEmpty()) {
+        LOG_DEBUG(QString("Dropping queued command: %1").arg(m_pending.last()->text()));
+        delete m_pending.takeLast();
+        emitExecutionChanged();
+        return;
+    }
+    if (m_running) {
+        m_cancelled->store(true);
+        emitExecutionChanged();
+        return;
+    }
+    m_undoStack->undo();
+}
+
+void CommandManager::redo()
+{
+    // Queued edits are newer than the redo history: they finish first,
+    // and pushing them discards what redo would have restored
+    finishPendingCommands();
+    m_undoStack->redo();
 }
 
 bool CommandManager::canUndo() const
@@ -47,12 +313,19 @@ bool CommandManager::canRedo() const
     return m_undoStack->canRedo();
 }
 
-QAction* CommandManager::createUndoAction(QObject *parent, const QString &prefix) const
+QAction* CommandManager::createUndoAction(QObject *parent, const QString &prefix)
 {
-    return m_undoStack->createUndoAction(parent, prefix);
+    // Keep QUndoStack's text and enabled state, but trigger through undo()
+    QAction *action = m_undoStack->createUndoAction(parent, prefix);
+    disconnect(action, &QAction::triggered, m_undoStack, &QUndoStack::undo);
+    connect(action, &QAction::triggered, this, &CommandManager::undo);
+    return action;
 }
 
-QAction* CommandManager::createRedoAction(QObject *parent, const QString &prefix) const
+QAction* CommandManager::createRedoAction(QObject *parent, const QString &prefix)
 {
-    return m_undoStack->createRedoAction(parent, prefix);
+    QAction *action = m_undoStack->createRedoAction(parent, prefix);
+    disconnect(action, &QAction::triggered, m_undoStack, &QUndoStack::redo);
+    connect(action, &QAction::triggered, this, &CommandManager::redo);
+    return action;
 }
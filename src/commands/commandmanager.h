@@ -2,10 +2,16 @@
 #define COMMANDMANAGER_H
 
 #include <QObject>
+#include <QQueue>
 #include <QUndoStack>
+#include <atomic>
+#include <memory>
 
+class ImageCommand;
 class ImageDocument;
 class ImageProcessor;
+class UndoScratchFile;
+template <typename T> class QFutureWatcher;
 
 /**
  * @class CommandManager
@@ -19,6 +25,17 @@ class ImageProcessor;
  * - Execute commands through the stack
  * - Provide undo/redo actions for UI binding
  * - Track command execution state
+ * - Keep the undo data in memory within a budget: the commands farthest
+ *   from the current index are moved to a compressed scratch file and
+ *   read back transparently when they are undone or redone. They are
+ *   compressed on a worker and written once that finishes.
+ * - Compute image commands on a worker thread: executeCommand() returns
+ *   at once and the command is pushed when its result is ready. Commands
+ *   executed meanwhile queue behind it and start from its result. If the
+ *   image was undone or redone while a command computed, it runs again
+ *   on the new image.
+ * - Merge repeated edits of one kind (ImageCommand::mergeWith()) into a
+ *   single history entry computed once
  *
  * Benefits:
  * - Separates command execution from UI logic
@@ -37,24 +54,39 @@ public:
     QUndoStack* undoStack() { return m_undoStack; }
     const QUndoStack* undoStack() const { return m_undoStack; }
 
-    // Execute a command
+    // Queue a command, it is pushed once computed (takes ownership)
     void executeCommand(QUndoCommand *command);
 
-    // Clear command history
+    // Commands computing or waiting
+    bool isBusy() const { return m_running || !m_pending.isEmpty(); }
+    int pendingCount() const { return m_pending.size() + (m_running ? 1 : 0); }
+
+    // Block until every queued command has been pushed
+    void finishPendingCommands();
+
+    // Clear command history, cancels queued commands
     void clear();
 
     // Check if we can undo/redo
     bool canUndo() const;
     bool canRedo() const;
 
+    // Memory budget for undo data in bytes (SettingsManager::undoMemoryBudget())
+    qint64 memoryBudget() const { return m_memoryBudget; }
+    void setMemoryBudget(qint64 bytes);
+
     // Get undo/redo actions for menu/toolbar
-    QAction* createUndoAction(QObject *parent, const QString &prefix = QString()) const;
-    QAction* createRedoAction(QObject *parent, const QString &prefix = QString()) const;
+    QAction* createUndoAction(QObject *parent, const QString &prefix = QString());
+    QAction* createRedoAction(QObject *parent, const QString &prefix = QString());
 
 signals:
     // Emitted when command is executed
     void commandExecuted();
 
+    // Emitted when a command starts computing, with the number of commands
+    // still to push; text is empty once the queue is empty
+    void executionChanged(const QString &text, int pendingCount);
+
     // Emitted when undo/redo state changes
     void canUndoChanged(bool canUndo);
     void canRedoChanged(bool canRedo);
@@ -62,10 +94,48 @@ signals:
     // Emitted when the command stack changes
     void indexChanged(int index);
 
+    // Emitted before indexChanged() when the user moved through the history
+    // (undo, redo, history view), not when a finished command was pushed
+    void historyNavigated();
+
+    // Emitted after the history was checked against the budget
+    void historyMemoryChanged(qint64 residentBytes, qint64 spilledBytes);
+
+public slots:
+    // Drop queued commands and stop the one computing
+    void cancelPendingCommands();
+
+    // Undo first abandons the newest command not pushed yet, redo waits for them
+    void undo();
+    void redo();
+
+private slots:
+    void onCommandFinished();
+    void onIndexChanged(int index);
+    void onSpillFinished();
+
 private:
+    void enforceMemoryBudget();
+    void startNextCommand();
+    void pushCommand(QUndoCommand *command);
+    void emitExecutionChanged();
+
     ImageDocument *m_document;
     ImageProcessor *m_processor;
     QUndoStack *m_undoStack;
+    qint64 m_memoryBudget;
+    std::shared_ptr<UndoScratchFile> m_scratch;  // Created on first spill
+    QFutureWatcher<void> *m_spillWatcher;        // Compresses the undo data to spill
+    bool m_budgetOutdated;                       // The history changed while it ran
+
+    // Background execution
+    QQueue<QUndoCommand*> m_pending;
+    ImageCommand *m_running;
+    qint64 m_runningInputKey;  // cacheKey() of the image it started from
+    bool m_runningMerges;      // It absorbed the command on top of the stack
+    bool m_pushing;            // Index changes come from a push, not navigation
+    QFutureWatcher<void> *m_watcher;
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
 };
 
 #endif // COMMANDMANAGER_H
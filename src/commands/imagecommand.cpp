@@ -1,37 +1,174 @@
 #include "imagecommand.h"
 #include "../imageprocessor.h"
+#include "../processing/pixelkernels.h"
+#include <QElapsedTimer>
 
 // Base ImageCommand implementation
 ImageCommand::ImageCommand(QImage *targetImage, const QString &text, QUndoCommand *parent)
     : QUndoCommand(text, parent)
     , m_targetImage(targetImage)
-    , m_previousImage(*targetImage)
     , m_firstRedo(true)
+    , m_preparedCost(0)
+    , m_isPrepared(false)
+    , m_replayBase(nullptr)
+    , m_replayed(false)
+    , m_chainLength(0)
+    , m_chainCost(0)
 {
 }
 
 void ImageCommand::undo()
 {
-    if (m_targetImage) {
-        *m_targetImage = m_previousImage;
-    }
+    if (!m_targetImage)
+        return;
+
+    if (m_replayed)
+        *m_targetImage = inputImage();
+    else
+        m_delta.swap(m_targetImage);
 }
 
 void ImageCommand::redo()
 {
-    if (m_targetImage) {
-        if (m_firstRedo) {
-            m_newImage = applyOperation(m_previousImage);
-            m_firstRedo = false;
+    if (!m_targetImage)
+        return;
+
+    if (!m_firstRedo) {
+        if (m_replayed)
+            applyInPlace(m_targetImage);
+        else
+            m_delta.swap(m_targetImage);
+        return;
+    }
+    m_firstRedo = false;
+
+    const QRect region = localRegion(*m_targetImage);
+    if (!region.isEmpty()) {
+        // Only the tiles under the edit are saved, the rest is never copied
+        ImageDelta delta(*m_targetImage, region);
+        QElapsedTimer timer;
+        timer.start();
+        applyInPlace(m_targetImage);
+        if (!extendReplayChain(timer.elapsed()))
+            m_delta = delta;
+        return;
+    }
+
+    if (!m_isPrepared)
+        prepare(*m_targetImage);
+    const QImage result = m_prepared;
+    const qint64 cost = m_preparedCost;
+    m_prepared = QImage();
+
+    if (!extendReplayChain(cost)) {
+        // A keyframe costs the whole input image, a local edit's delta may be smaller
+        ImageDelta delta(*m_targetImage, result);
+        if (cost <= MaxReplayMs && delta.isFull()) {
+            m_delta = ImageDelta(*m_targetImage, QImage());
+            m_replayed = true;
+            m_chainLength = 1;
+            m_chainCost = cost;
+        } else {
+            m_delta = delta;
         }
-        *m_targetImage = m_newImage;
     }
+
+    *m_targetImage = result;
+}
+
+void ImageCommand::applyInPlace(QImage *image)
+{
+    *image = applyOperation(*image);
+}
+
+QRect ImageCommand::localRegion(const QImage &image) const
+{
+    const QRect region = affectedRect(image).intersected(image.rect());
+    if (region.isEmpty())
+        return QRect();
+
+    // Past this size a regular operation and a compared delta cost no more
+    const qint64 area = qint64(region.width()) * region.height();
+    if (area > ImageDelta::FullThreshold * image.width() * image.height())
+        return QRect();
+
+    return region;
+}
+
+bool ImageCommand::extendReplayChain(qint64 cost)
+{
+    ImageCommand *base = m_replayBase;
+    m_replayBase = nullptr;
+    if (!base || !base->m_replayed || base->m_targetImage != m_targetImage
+        || base->m_chainLength >= KeyframeInterval || base->m_chainCost + cost > MaxReplayMs)
+        return false;
+
+    // Nothing to store: undo replays the chain up to the previous command
+    m_replayBase = base;
+    m_replayed = true;
+    m_chainLength = base->m_chainLength + 1;
+    m_chainCost = base->m_chainCost + cost;
+    return true;
+}
+
+void ImageCommand::prepare(const QImage &input)
+{
+    // Local edits are applied in place by redo(), there is nothing to compute ahead
+    if (!localRegion(input).isEmpty())
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+    m_prepared = applyOperation(input);
+    m_preparedCost = timer.elapsed();
+    m_isPrepared = true;
+}
+
+bool ImageCommand::mergeWith(const QUndoCommand *other)
+{
+    const ImageCommand *older = dynamic_cast<const ImageCommand*>(other);
+    if (!m_firstRedo || !older || older == this || older->id() != id()
+        || older->m_targetImage != m_targetImage)
+        return false;
+
+    return mergeParameters(older);
+}
+
+void ImageCommand::unmerge()
+{
+    unmergeParameters();
+    m_prepared = QImage();
+    m_preparedCost = 0;
+    m_isPrepared = false;
+}
+
+QImage ImageCommand::inputImage()
+{
+    if (m_firstRedo)
+        return m_targetImage ? *m_targetImage : QImage();
+
+    if (!m_replayed)
+        return m_targetImage ? m_delta.applied(*m_targetImage) : QImage();
+
+    // Walk back to the keyframe, then replay the chain forward
+    QVector<ImageCommand*> chain;
+    ImageCommand *keyframe = this;
+    while (keyframe->m_replayBase) {
+        keyframe = keyframe->m_replayBase;
+        chain.prepend(keyframe);
+    }
+
+    QImage image = keyframe->m_delta.fullImage();
+    for (ImageCommand *command : chain)
+        command->applyInPlace(&image);
+    return image;
 }
 
 // BrightnessCommand
 BrightnessCommand::BrightnessCommand(QImage *targetImage, int brightness, QUndoCommand *parent)
     : ImageCommand(targetImage, QObject::tr("Adjust Brightness"), parent)
     , m_brightness(brightness)
+    , m_ownBrightness(brightness)
 {
 }
 
@@ -41,6 +178,32 @@ QImage BrightnessCommand::applyOperation(const QImage &image)
     return processor.adjustBrightness(image, m_brightness);
 }
 
+void BrightnessCommand::applyInPlace(QImage *image)
+{
+    ImageProcessor processor;
+    *image = processor.adjustBrightness(std::move(*image), m_brightness);
+}
+
+bool BrightnessCommand::mergeParameters(const ImageCommand *older)
+{
+    // Offsets of the same sign add up exactly: a channel that clamps stays
+    // clamped. Opposite signs do not (+50 then -50 flattens the highlights),
+    // nor does an image that converts to the working format and back
+    const int previous = static_cast<const BrightnessCommand*>(older)->m_brightness;
+    const int combined = m_brightness + previous;
+    if (m_brightness * previous < 0 || qAbs(combined) > 100
+        || m_targetImage->format() != PixelKernels::workingFormat(*m_targetImage))
+        return false;
+
+    m_brightness = combined;
+    return true;
+}
+
+void BrightnessCommand::unmergeParameters()
+{
+    m_brightness = m_ownBrightness;
+}
+
 // ContrastCommand
 ContrastCommand::ContrastCommand(QImage *targetImage, int contrast, QUndoCommand *parent)
     : ImageCommand(targetImage, QObject::tr("Adjust Contrast"), parent)
@@ -54,6 +217,12 @@ QImage ContrastCommand::applyOperation(const QImage &image)
     return processor.adjustContrast(image, m_contrast);
 }
 
+void ContrastCommand::applyInPlace(QImage *image)
+{
+    ImageProcessor processor;
+    *image = processor.adjustContrast(std::move(*image), m_contrast);
+}
+
 // SaturationCommand
 SaturationCommand::SaturationCommand(QImage *targetImage, int saturation, QUndoCommand *parent)
     : ImageCommand(targetImage, QObject::tr("Adjust Saturation"), parent)
@@ -67,6 +236,12 @@ QImage SaturationCommand::applyOperation(const QImage &image)
     return processor.adjustSaturation(image, m_saturation);
 }
 
+void SaturationCommand::applyInPlace(QImage *image)
+{
+    ImageProcessor processor;
+    *image = processor.adjustSaturation(std::move(*image), m_saturation);
+}
+
 // HueCommand
 HueCommand::HueCommand(QImage *targetImage, int hue, QUndoCommand *parent)
     : ImageCommand(targetImage, QObject::tr("Adjust Hue"), parent)
@@ -80,6 +255,12 @@ QImage HueCommand::applyOperation(const QImage &image)
     return processor.adjustHue(image, m_hue);
 }
 
+void HueCommand::applyInPlace(QImage *image)
+{
+    ImageProcessor processor;
+    *image = processor.adjustHue(std::move(*image), m_hue);
+}
+
 // GammaCommand
 GammaCommand::GammaCommand(QImage *targetImage, double gamma, QUndoCommand *parent)
     : ImageCommand(targetImage, QObject::tr("Adjust Gamma"), parent)
@@ -93,6 +274,12 @@ QImage GammaCommand::applyOperation(const QImage &image)
     return processor.adjustGamma(image, m_gamma);
 }
 
+void GammaCommand::applyInPlace(QImage *image)
+{
+    ImageProcessor processor;
+    *image = processor.adjustGamma(std::move(*image), m_gamma);
+}
+
 // ColorTemperatureCommand
 ColorTemperatureCommand::ColorTemperatureCommand(QImage *targetImage, int temperature, QUndoCommand *parent)
     : ImageCommand(targetImage, QObject::tr("Adjust Color Temperature"), parent)
@@ -106,6 +293,12 @@ QImage ColorTemperatureCommand::applyOperation(const QImage &image)
     return processor.adjustColorTemperature(image, m_temperature);
 }
 
+void ColorTemperatureCommand::applyInPlace(QImage *image)
+{
+    ImageProcessor processor;
+    *image = processor.adjustColorTemperature(std::move(*image), m_temperature);
+}
+
 // ExposureCommand
 ExposureCommand::ExposureCommand(QImage *targetImage, int exposure, QUndoCommand *parent)
     : ImageCommand(targetImage, QObject::tr("Adjust Exposure"), parent)
@@ -119,6 +312,12 @@ QImage ExposureCommand::applyOperation(const QImage &image)
     return processor.adjustExposure(image, m_exposure);
 }
 
+void ExposureCommand::applyInPlace(QImage *image)
+{
+    ImageProcessor processor;
+    *image = processor.adjustExposure(std::move(*image), m_exposure);
+}
+
 // ShadowsCommand
 ShadowsCommand::ShadowsCommand(QImage *targetImage, int shadows, QUndoCommand *parent)
     : ImageCommand(targetImage, QObject::tr("Adjust Shadows"), parent)
@@ -132,6 +331,12 @@ QImage ShadowsCommand::applyOperation(const QImage &image)
     return processor.adjustShadows(image, m_shadows);
 }
 
+void ShadowsCommand::applyInPlace(QImage *image)
+{
+    ImageProcessor processor;
+    *image = processor.adjustShadows(std::move(*image), m_shadows);
+}
+
 // HighlightsCommand
 HighlightsCommand::HighlightsCommand(QImage *targetImage, int highlights, QUndoCommand *parent)
     : ImageCommand(targetImage, QObject::tr("Adjust Highlights"), parent)
@@ -145,6 +350,12 @@ QImage HighlightsCommand::applyOperation(const QImage &image)
     return processor.adjustHighlights(image, m_highlights);
 }
 
+void HighlightsCommand::applyInPlace(QImage *image)
+{
+    ImageProcessor processor;
+    *image = processor.adjustHighlights(std::move(*image), m_highlights);
+}
+
 // FilterCommand
 FilterCommand::FilterCommand(QImage *targetImage, FilterType filterType, QUndoCommand *parent)
     : ImageCommand(targetImage, QString(), parent)
@@ -201,10 +412,39 @@ QImage BlurCommand::applyOperation(const QImage &image)
     return processor.applyBlur(image, m_radius);
 }
 
+// ConvolutionCommand
+ConvolutionCommand::ConvolutionCommand(QImage *targetImage, const ConvolutionKernel &kernel,
+                                       Convolution::BorderMode border, QUndoCommand *parent)
+    : ImageCommand(targetImage, QObject::tr("Apply Custom Kernel"), parent)
+    , m_kernel(kernel)
+    , m_border(border)
+{
+}
+
+QImage ConvolutionCommand::applyOperation(const QImage &image)
+{
+    ImageProcessor processor;
+    return processor.applyConvolution(image, m_kernel, m_border);
+}
+
+// ColorLutCommand
+ColorLutCommand::ColorLutCommand(QImage *targetImage, const ColorLut3D &lut, QUndoCommand *parent)
+    : ImageCommand(targetImage, QObject::tr("Apply LUT %1").arg(lut.title()), parent)
+    , m_lut(lut)
+{
+}
+
+QImage ColorLutCommand::applyOperation(const QImage &image)
+{
+    ImageProcessor processor;
+    return processor.applyColorLut(image, m_lut);
+}
+
 // RotateCommand
 RotateCommand::RotateCommand(QImage *targetImage, int angle, QUndoCommand *parent)
     : ImageCommand(targetImage, QObject::tr("Rotate Image"), parent)
     , m_angle(angle)
+    , m_ownAngle(angle)
 {
 }
 
@@ -214,6 +454,23 @@ QImage RotateCommand::applyOperation(const QImage &image)
     return processor.rotate(image, m_angle);
 }
 
+bool RotateCommand::mergeParameters(const ImageCommand *older)
+{
+    // Right angles only: any other angle grows the canvas, so two rotations
+    // are not one rotation by the sum
+    const int previous = static_cast<const RotateCommand*>(older)->m_angle;
+    if (m_angle % 90 != 0 || previous % 90 != 0)
+        return false;
+
+    m_angle = (m_angle + previous) % 360;
+    return true;
+}
+
+void RotateCommand::unmergeParameters()
+{
+    m_angle = m_ownAngle;
+}
+
 // FlipCommand
 FlipCommand::FlipCommand(QImage *targetImage, FlipType flipType, QUndoCommand *parent)
     : ImageCommand(targetImage, QString(), parent)
@@ -232,6 +489,16 @@ QImage FlipCommand::applyOperation(const QImage &image)
     }
 }
 
+void FlipCommand::applyInPlace(QImage *image)
+{
+    ImageProcessor processor;
+    if (m_flipType == Horizontal) {
+        *image = processor.flipHorizontal(std::move(*image));
+    } else {
+        *image = processor.flipVertical(std::move(*image));
+    }
+}
+
 // ResizeCommand
 ResizeCommand::ResizeCommand(QImage *targetImage, int width, int height, QUndoCommand *parent)
     : ImageCommand(targetImage, QObject::tr("Resize Image"), parent)
@@ -277,6 +544,17 @@ QImage TextWatermarkCommand::applyOperation(const QImage &image)
     return processor.addTextWatermark(image, m_text, m_x, m_y);
 }
 
+QRect TextWatermarkCommand::affectedRect(const QImage &image) const
+{
+    return ImageProcessor::textWatermarkRect(image, m_text, m_x, m_y);
+}
+
+void TextWatermarkCommand::applyInPlace(QImage *image)
+{
+    ImageProcessor processor;
+    processor.paintTextWatermark(image, m_text, m_x, m_y);
+}
+
 // ImageWatermarkCommand
 ImageWatermarkCommand::ImageWatermarkCommand(QImage *targetImage, const QImage &watermark, int x, int y, QUndoCommand *parent)
     : ImageCommand(targetImage, QObject::tr("Add Image Watermark"), parent)
@@ -292,17 +570,62 @@ QImage ImageWatermarkCommand::applyOperation(const QImage &image)
     return processor.addImageWatermark(image, m_watermark, m_x, m_y);
 }
 
+QRect ImageWatermarkCommand::affectedRect(const QImage &image) const
+{
+    Q_UNUSED(image);
+    return ImageProcessor::imageWatermarkRect(m_watermark, m_x, m_y);
+}
+
+void ImageWatermarkCommand::applyInPlace(QImage *image)
+{
+    ImageProcessor processor;
+    processor.paintImageWatermark(image, m_watermark, m_x, m_y);
+}
+
 // CompoundAdjustmentCommand
-CompoundAdjustmentCommand::CompoundAdjustmentCommand(QImage *targetImage, const QString &text)
-    : QUndoCommand(text)
-    , m_targetImage(targetImage)
+CompoundAdjustmentCommand::CompoundAdjustmentCommand(QImage *targetImage, const AdjustmentParameters &params,
+                                                     const QString &text, QUndoCommand *parent)
+    : ImageCommand(targetImage, text, parent)
+    , m_params(params)
 {
-    // Note: Child commands are added via constructor parameter, not via addAdjustment
-    // This is handled in MainWindow::onApplyAdjustments()
 }
 
-void CompoundAdjustmentCommand::addAdjustment(ImageCommand *command)
+QImage CompoundAdjustmentCommand::applyOperation(const QImage &image)
 {
-    // The command becomes a child - it's already added via parent in constructor
-    // No action needed here
+    ImageProcessor processor;
+    return processor.applyAdjustments(image, m_params);
+}
+
+void CompoundAdjustmentCommand::applyInPlace(QImage *image)
+{
+    ImageProcessor processor;
+    *image = processor.applyAdjustments(std::move(*image), m_params);
+}
+
+// PipelineCommand
+PipelineCommand::PipelineCommand(QImage *targetImage, const QVector<AdjustmentParameters> &passes,
+                                 const QVector<Filter> &filters, const QString &text,
+                                 QUndoCommand *parent)
+    : ImageCommand(targetImage, text, parent)
+    , m_passes(passes)
+    , m_filters(filters)
+{
+}
+
+QImage PipelineCommand::applyOperation(const QImage &image)
+{
+    ImageProcessor processor;
+    // The first pass detaches from the input, the others run in place
+    QImage result = image;
+    for (const AdjustmentParameters &params : m_passes) {
+        if (params.hasAnyAdjustments())
+            result = processor.applyAdjustments(std::move(result), params);
+    }
+    for (const Filter &filter : m_filters) {
+        if (filter.type == Filter::Sharpen)
+            result = processor.applySharpen(result);
+        else
+            result = processor.applyBlur(result, filter.radius);
+    }
+    return result;
 }
@@ -4,24 +4,135 @@
 #include <QUndoCommand>
 #include <QImage>
 #include <functional>
-
-// Base class for all image editing commands
+#include "../processing/colorlut3d.h"
+#include "../processing/convolution.h"
+#include "../model/adjustmentparameters.h"
+#include "imagedelta.h"
+
+/**
+ * Base class for all image editing commands
+ *
+ * The first redo() times applyOperation() and picks how undo works:
+ * - Replayed, no pixels: the command is cheap and the previous command
+ *   is replayed too, so its input is rebuilt by replaying the chain from
+ *   the last keyframe. A chain holds at most KeyframeInterval commands
+ *   whose operations took MaxReplayMs together.
+ * - Replayed keyframe: a cheap command that starts a new chain keeps its
+ *   input image in full.
+ * - Stored: an expensive command, or one whose change is local enough
+ *   that its tile delta is smaller than a keyframe, keeps an ImageDelta
+ *   (the changed tiles of the version that is not in the document).
+ * Replayed commands redo by running the operation again.
+ *
+ * Local edits report the area they change through affectedRect() and
+ * paint it with applyInPlace(): the document image is edited without a
+ * full copy, and the delta only holds the tiles under that area.
+ *
+ * Commands point at the previous command of their chain, so the undo
+ * stack must not drop its oldest commands (no QUndoStack undo limit).
+ *
+ * CommandManager computes the first redo on a worker thread with
+ * prepare() before pushing the command; redo() then only installs the
+ * prepared result.
+ *
+ * Commands whose parameters combine exactly (brightness, right-angle
+ * rotation) have an id() and merge: a command that has not run yet absorbs
+ * the previous command of the same id, and CommandManager applies the
+ * combined parameters once to that command's input, replacing it on the
+ * stack. Repeated small tweaks thus keep one history entry and one set
+ * of undo data. A merge is only made when the combined command gives the
+ * same image as the two commands in sequence. Hue rotations do not merge:
+ * every pass rounds the pixels back to 8-bit RGB, so two rotations drift
+ * from one by their sum.
+ */
 class ImageCommand : public QUndoCommand
 {
 public:
+    static constexpr int KeyframeInterval = 8;
+    static constexpr qint64 MaxReplayMs = 250;
+
+    // QUndoCommand::id() of the commands that merge
+    enum CommandId {
+        BrightnessId = 1,
+        RotateId
+    };
+
     ImageCommand(QImage *targetImage, const QString &text, QUndoCommand *parent = nullptr);
 
     void undo() override;
     void redo() override;
 
+    /**
+     * Absorb an older command of the same id; only before this command has
+     * run (so QUndoStack::push() never merges executed commands by itself)
+     * @return False if the parameters do not combine
+     */
+    bool mergeWith(const QUndoCommand *other) override;
+
+    // Back to the command's own parameters after mergeWith(), unprepared
+    void unmerge();
+
+    // The image this command was applied to; unless the command is replayed,
+    // its result must be the live image
+    QImage inputImage();
+
+    QImage *targetImage() const { return m_targetImage; }
+
+    // Compute the result of the first redo from a copy of the target image,
+    // may run on any thread while nothing else touches the command
+    void prepare(const QImage &input);
+    bool isPrepared() const { return m_isPrepared; }
+
+    // Command executed right before this one, set before the first redo
+    void setReplayBase(ImageCommand *base) { m_replayBase = base; }
+    bool isReplayed() const { return m_replayed; }
+
+    // Memory held for undo/redo
+    qint64 undoBytes() const { return m_delta.bytes(); }
+
+    // Move the undo data to the scratch file, it is read back on the next
+    // undo/redo. The job compresses it (any thread), see ImageDelta::spill()
+    std::function<void()> spillUndoData() { return m_delta.spill(); }
+    bool completeSpill(const std::shared_ptr<UndoScratchFile> &scratch) { return m_delta.completeSpill(scratch); }
+    bool isSpillPending() const { return m_delta.isSpillPending(); }
+    qint64 spilledBytes() const { return m_delta.spilledBytes(); }
+
 protected:
     // Override this in derived classes to perform the actual operation
     virtual QImage applyOperation(const QImage &image) = 0;
 
+    // Area a local edit changes; a null rect (default) means anywhere
+    virtual QRect affectedRect(const QImage &image) const { Q_UNUSED(image); return QRect(); }
+
+    // Apply the operation to the image itself: local edits change only
+    // affectedRect(), point operations reuse the buffer unless it is shared
+    virtual void applyInPlace(QImage *image);
+
+    // Combine the parameters of an older command of the same id into this one
+    virtual bool mergeParameters(const ImageCommand *older) { Q_UNUSED(older); return false; }
+
+    // Drop the parameters mergeParameters() absorbed
+    virtual void unmergeParameters() {}
+
     QImage *m_targetImage;
-    QImage m_previousImage;
-    QImage m_newImage;
+    ImageDelta m_delta;
     bool m_firstRedo;
+
+private:
+    // affectedRect() clipped to the image, null unless small enough to edit in place
+    QRect localRegion(const QImage &image) const;
+
+    // Join the replay chain of the previous command if it stays within the limits
+    bool extendReplayChain(qint64 cost);
+
+    QImage m_prepared;
+    qint64 m_preparedCost;
+    bool m_isPrepared;
+
+    ImageCommand *m_replayBase;  // Null for keyframes and stored commands
+    bool m_replayed;
+    int m_chainLength;           // Commands from the keyframe up to this one
+    qint64 m_chainCost;          // Their operation time in milliseconds
 };
 
 // Adjustment commands
@@ -30,11 +141,17 @@ class BrightnessCommand : public ImageCommand
 public:
     BrightnessCommand(QImage *targetImage, int brightness, QUndoCommand *parent = nullptr);
 
+    int id() const override { return BrightnessId; }
+
 protected:
     QImage applyOperation(const QImage &image) override;
+    void applyInPlace(QImage *image) override;
+    bool mergeParameters(const ImageCommand *older) override;
+    void unmergeParameters() override;
 
 private:
     int m_brightness;
+    int m_ownBrightness;
 };
 
 class ContrastCommand : public ImageCommand
@@ -44,6 +161,7 @@ public:
 
 protected:
     QImage applyOperation(const QImage &image) override;
+    void applyInPlace(QImage *image) override;
 
 private:
     int m_contrast;
@@ -56,6 +174,7 @@ public:
 
 protected:
     QImage applyOperation(const QImage &image) override;
+    void applyInPlace(QImage *image) override;
 
 private:
     int m_saturation;
@@ -68,6 +187,7 @@ public:
 
 protected:
     QImage applyOperation(const QImage &image) override;
+    void applyInPlace(QImage *image) override;
 
 private:
     int m_hue;
@@ -80,6 +200,7 @@ public:
 
 protected:
     QImage applyOperation(const QImage &image) override;
+    void applyInPlace(QImage *image) override;
 
 private:
     double m_gamma;
@@ -93,6 +214,7 @@ public:
 
 protected:
     QImage applyOperation(const QImage &image) override;
+    void applyInPlace(QImage *image) override;
 
 private:
     int m_temperature;
@@ -105,6 +227,7 @@ public:
 
 protected:
     QImage applyOperation(const QImage &image) override;
+    void applyInPlace(QImage *image) override;
 
 private:
     int m_exposure;
@@ -117,6 +240,7 @@ public:
 
 protected:
     QImage applyOperation(const QImage &image) override;
+    void applyInPlace(QImage *image) override;
 
 private:
     int m_shadows;
@@ -129,6 +253,7 @@ public:
 
 protected:
     QImage applyOperation(const QImage &image) override;
+    void applyInPlace(QImage *image) override;
 
 private:
     int m_highlights;
@@ -167,17 +292,49 @@ private:
     int m_radius;
 };
 
+class ConvolutionCommand : public ImageCommand
+{
+public:
+    ConvolutionCommand(QImage *targetImage, const ConvolutionKernel &kernel,
+                       Convolution::BorderMode border = Convolution::Clamp,
+                       QUndoCommand *parent = nullptr);
+
+protected:
+    QImage applyOperation(const QImage &image) override;
+
+private:
+    ConvolutionKernel m_kernel;
+    Convolution::BorderMode m_border;
+};
+
+class ColorLutCommand : public ImageCommand
+{
+public:
+    ColorLutCommand(QImage *targetImage, const ColorLut3D &lut, QUndoCommand *parent = nullptr);
+
+protected:
+    QImage applyOperation(const QImage &image) override;
+
+private:
+    ColorLut3D m_lut;
+};
+
 // Transformation commands
 class RotateCommand : public ImageCommand
 {
 public:
     RotateCommand(QImage *targetImage, int angle, QUndoCommand *parent = nullptr);
 
+    int id() const override { return RotateId; }
+
 protected:
     QImage applyOperation(const QImage &image) override;
+    bool mergeParameters(const ImageCommand *older) override;
+    void unmergeParameters() override;
 
 private:
     int m_angle;
+    int m_ownAngle;
 };
 
 class FlipCommand : public ImageCommand
@@ -192,6 +349,7 @@ public:
 
 protected:
     QImage applyOperation(const QImage &image) override;
+    void applyInPlace(QImage *image) override;
 
 private:
     FlipType m_flipType;
@@ -233,6 +391,8 @@ public:
 
 protected:
     QImage applyOperation(const QImage &image) override;
+    QRect affectedRect(const QImage &image) const override;
+    void applyInPlace(QImage *image) override;
 
 private:
     QString m_text;
@@ -247,6 +407,8 @@ public:
 
 protected:
     QImage applyOperation(const QImage &image) override;
+    QRect affectedRect(const QImage &image) const override;
+    void applyInPlace(QImage *image) override;
 
 private:
     QImage m_watermark;
@@ -255,15 +417,51 @@ private:
 };
 
 // Compound command for applying multiple adjustments at once
-class CompoundAdjustmentCommand : public QUndoCommand
+// (all active stages run in a single fused pass over the image)
+class CompoundAdjustmentCommand : public ImageCommand
+{
+public:
+    CompoundAdjustmentCommand(QImage *targetImage, const AdjustmentParameters &params,
+                              const QString &text = QObject::tr("Adjust Image"),
+                              QUndoCommand *parent = nullptr);
+
+    const AdjustmentParameters &parameters() const { return m_params; }
+
+protected:
+    QImage applyOperation(const QImage &image) override;
+    void applyInPlace(QImage *image) override;
+
+private:
+    AdjustmentParameters m_params;
+};
+
+// Adjustments and filters applied as one step (AI suggestions): each set of
+// point adjustments runs in one fused pass, in order, then the neighborhood
+// filters in order
+class PipelineCommand : public ImageCommand
 {
 public:
-    CompoundAdjustmentCommand(QImage *targetImage, const QString &text = QObject::tr("Adjust Image"));
+    struct Filter
+    {
+        enum Type {
+            Sharpen,
+            Blur
+        };
+
+        Type type;
+        int radius;  // Blur only
+    };
 
-    void addAdjustment(ImageCommand *command);
+    PipelineCommand(QImage *targetImage, const QVector<AdjustmentParameters> &passes,
+                    const QVector<Filter> &filters, const QString &text,
+                    QUndoCommand *parent = nullptr);
+
+protected:
+    QImage applyOperation(const QImage &image) override;
 
 private:
-    QImage *m_targetImage;
+    QVector<AdjustmentParameters> m_passes;
+    QVector<Filter> m_filters;
 };
 
 #endif // IMAGECOMMAND_H
@@ -0,0 +1,318 @@
+#include "imagedelta.h"
+#include "../processing/parallelrows.h"
+#include "../logging/logger.h"
+#include <QDataStream>
+#include <QColorSpace>
+#include <cstring>
+#include <utility>
+
+// Raw pixels plus the metadata a QImage carries; QDataStream's own QImage
+// format is PNG, which is slow and does not keep the pixel format
+static void writeImage(QDataStream &stream, const QImage &image)
+{
+    stream << image.width() << image.height() << qint32(image.format())
+           << image.colorTable() << image.colorSpace()
+           << image.dotsPerMeterX() << image.dotsPerMeterY();
+
+    QMap<QString, QString> text;
+    for (const QString &key : image.textKeys())
+        text.insert(key, image.text(key));
+    stream << text;
+
+    const int rowBytes = (image.width() * image.depth() + 7) / 8;
+    for (int y = 0; y < image.height(); ++y)
+        stream.writeRawData(reinterpret_cast<const char*>(image.constScanLine(y)), rowBytes);
+}
+
+static QImage readImage(QDataStream &stream)
+{
+    int width = 0, height = 0, dotsX = 0, dotsY = 0;
+    qint32 format = 0;
+    QList<QRgb> colorTable;
+    QColorSpace colorSpace;
+    QMap<QString, QString> text;
+    stream >> width >> height >> format >> colorTable >> colorSpace >> dotsX >> dotsY >> text;
+    if (stream.status() != QDataStream::Ok)
+        return QImage();
+
+    QImage image(width, height, QImage::Format(format));
+    if (image.isNull())
+        return image;
+
+    image.setColorTable(colorTable);
+    image.setColorSpace(colorSpace);
+    image.setDotsPerMeterX(dotsX);
+    image.setDotsPerMeterY(dotsY);
+    for (auto it = text.cbegin(); it != text.cend(); ++it)
+        image.setText(it.key(), it.value());
+
+    const int rowBytes = (width * image.depth() + 7) / 8;
+    for (int y = 0; y < height; ++y)
+        stream.readRawData(reinterpret_cast<char*>(image.scanLine(y)), rowBytes);
+
+    return stream.status() == QDataStream::Ok ? image : QImage();
+}
+
+ImageDelta::ImageDelta()
+{
+}
+
+ImageDelta::ImageDelta(const QImage &other, const QImage &live)
+{
+    if (other.isNull())
+        return;
+
+    // Tiles need the same layout and whole bytes per pixel; what a tile
+    // cannot carry (palette, color space) must match as well
+    if (other.size() != live.size() || other.format() != live.format() || other.depth() % 8 != 0
+        || other.colorTable() != live.colorTable() || other.colorSpace() != live.colorSpace()) {
+        m_full = other;
+        return;
+    }
+
+    const int width = other.width();
+    const int height = other.height();
+    const int bytesPerPixel = other.depth() / 8;
+    const int columns = (width + TileSize - 1) / TileSize;
+    const int rows = (height + TileSize - 1) / TileSize;
+
+    // Each band compares whole tile rows and only writes its own flags
+    QVector<char> changed(columns * rows, 0);
+    char *flags = changed.data();
+    ParallelRows::forRanges(rows, width * TileSize, [&](int begin, int end) {
+        for (int tileRow = begin; tileRow < end; ++tileRow) {
+            const int top = tileRow * TileSize;
+            const int bottom = qMin(top + TileSize, height);
+            for (int y = top; y < bottom; ++y) {
+                const uchar *a = other.constScanLine(y);
+                const uchar *b = live.constScanLine(y);
+                for (int column = 0; column < columns; ++column) {
+                    char &flag = flags[tileRow * columns + column];
+                    if (flag)
+                        continue;
+                    const int left = column * TileSize * bytesPerPixel;
+                    const int span = (qMin((column + 1) * TileSize, width) - column * TileSize) * bytesPerPixel;
+                    flag = std::memcmp(a + left, b + left, span) != 0;
+                }
+            }
+        }
+    });
+
+    qint64 changedPixels = 0;
+    for (int i = 0; i < changed.size(); ++i) {
+        if (changed[i]) {
+            const int column = i % columns;
+            const int row = i / columns;
+            changedPixels += qint64(qMin(TileSize, width - column * TileSize))
+                           * qMin(TileSize, height - row * TileSize);
+        }
+    }
+
+    if (changedPixels > FullThreshold * width * height) {
+        m_full = other;
+        return;
+    }
+
+    for (int i = 0; i < changed.size(); ++i) {
+        if (!changed[i])
+            continue;
+        const QPoint origin((i % columns) * TileSize, (i / columns) * TileSize);
+        const QSize size(qMin(TileSize, width - origin.x()), qMin(TileSize, height - origin.y()));
+        m_tiles.append({origin, other.copy(QRect(origin, size))});
+    }
+}
+
+ImageDelta::ImageDelta(const QImage &live, const QRect &region)
+{
+    const QRect area = region.intersected(live.rect());
+    if (live.isNull() || area.isEmpty())
+        return;
+
+    if (live.depth() % 8 != 0) {
+        m_full = live;
+        return;
+    }
+
+    const int firstColumn = area.left() / TileSize;
+    const int lastColumn = area.right() / TileSize;
+    const int firstRow = area.top() / TileSize;
+    const int lastRow = area.bottom() / TileSize;
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            const QPoint origin(column * TileSize, row * TileSize);
+            const QSize size(qMin(TileSize, live.width() - origin.x()),
+                             qMin(TileSize, live.height() - origin.y()));
+            m_tiles.append({origin, live.copy(QRect(origin, size))});
+        }
+    }
+}
+
+void ImageDelta::swap(QImage *live)
+{
+    if (!live)
+        return;
+
+    if (isSpilled() && !pageIn())
+        return;
+
+    m_swapped = !m_swapped;
+    if (!m_full.isNull()) {
+        std::swap(*live, m_full);
+        return;
+    }
+
+    // One detach for the whole swap (a full copy only if the live image is shared)
+    if (!m_tiles.isEmpty())
+        live->bits();
+
+    for (Tile &tile : m_tiles) {
+        QImage previous(tile.pixels.size(), tile.pixels.format());
+        copyTile(*live, tile.origin, &previous, QPoint(0, 0), tile.pixels.size());
+        copyTile(tile.pixels, QPoint(0, 0), live, tile.origin, tile.pixels.size());
+        tile.pixels = previous;
+    }
+}
+
+std::function<void()> ImageDelta::spill()
+{
+    if (!isResident())
+        return nullptr;
+
+    // Still what the block holds: nothing to write
+    if (m_spill && m_spillSwapped == m_swapped) {
+        m_full = QImage();
+        m_tiles.clear();
+        m_pendingSpill.reset();
+        return nullptr;
+    }
+
+    // A job for the same version is already under way
+    if (m_pendingSpill && m_pendingSpill->swapped == m_swapped)
+        return nullptr;
+
+    // The copy shares the pixels; a later swap() replaces them instead of writing
+    auto pending = std::make_shared<PendingSpill>();
+    pending->full = m_full;
+    pending->tiles = m_tiles;
+    pending->swapped = m_swapped;
+    m_pendingSpill = pending;
+
+    return [pending]() {
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream << bool(!pending->full.isNull());
+        if (!pending->full.isNull()) {
+            writeImage(stream, pending->full);
+        } else {
+            stream << qint32(pending->tiles.size());
+            for (const Tile &tile : pending->tiles) {
+                stream << tile.origin;
+                writeImage(stream, tile.pixels);
+            }
+        }
+
+        pending->compressed = UndoScratchFile::compress(data);
+        pending->full = QImage();
+        pending->tiles.clear();
+    };
+}
+
+bool ImageDelta::completeSpill(const std::shared_ptr<UndoScratchFile> &scratch)
+{
+    const std::shared_ptr<PendingSpill> pending = std::move(m_pendingSpill);
+    if (!pending || pending->swapped != m_swapped || !isResident() || !scratch || !scratch->isValid())
+        return false;
+
+    const UndoScratchFile::Block block = scratch->write(pending->compressed);
+    if (!block.isValid())
+        return false;
+
+    m_spill = std::make_shared<SpilledBlock>();
+    m_spill->file = scratch;
+    m_spill->block = block;
+    m_spillSwapped = m_swapped;
+    m_full = QImage();
+    m_tiles.clear();
+    return true;
+}
+
+bool ImageDelta::pageIn()
+{
+    const QByteArray data = m_spill->file->read(m_spill->block);
+    QDataStream stream(data);
+
+    bool full = false;
+    stream >> full;
+    QImage image;
+    QVector<Tile> tiles;
+    if (full) {
+        image = readImage(stream);
+    } else {
+        qint32 count = 0;
+        stream >> count;
+        for (int i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            Tile tile;
+            stream >> tile.origin;
+            tile.pixels = readImage(stream);
+            tiles.append(tile);
+        }
+    }
+
+    if (data.isEmpty() || stream.status() != QDataStream::Ok || (full && image.isNull())) {
+        LOG_ERROR("Undo history could not be read back from the scratch file");
+        return false;
+    }
+
+    // Resident again; the block is kept so that spilling again costs nothing
+    m_full = image;
+    m_tiles = tiles;
+    return true;
+}
+
+QImage ImageDelta::fullImage()
+{
+    if (isSpilled() && !pageIn())
+        return QImage();
+
+    return m_full;
+}
+
+QImage ImageDelta::applied(const QImage &live)
+{
+    if (isSpilled() && !pageIn())
+        return QImage();
+
+    if (!m_full.isNull())
+        return m_full;
+
+    // The first tile written detaches the copy from the live image
+    QImage result = live;
+    for (const Tile &tile : m_tiles)
+        copyTile(tile.pixels, QPoint(0, 0), &result, tile.origin, tile.pixels.size());
+    return result;
+}
+
+qint64 ImageDelta::spilledBytes() const
+{
+    return isSpilled() ? m_spill->block.size : 0;
+}
+
+qint64 ImageDelta::bytes() const
+{
+    qint64 total = m_full.sizeInBytes();
+    for (const Tile &tile : m_tiles)
+        total += tile.pixels.sizeInBytes();
+    return total;
+}
+
+void ImageDelta::copyTile(const QImage &source, const QPoint &origin, QImage *target,
+                          const QPoint &targetOrigin, const QSize &size)
+{
+    const int bytesPerPixel = source.depth() / 8;
+    const qsizetype span = qsizetype(size.width()) * bytesPerPixel;
+    for (int y = 0; y < size.height(); ++y) {
+        const uchar *from = source.constScanLine(origin.y() + y) + origin.x() * bytesPerPixel;
+        uchar *to = target->scanLine(targetOrigin.y() + y) + targetOrigin.x() * bytesPerPixel;
+        std::memcpy(to, from, span);
+    }
+}
@@ -0,0 +1,124 @@
+#ifndef IMAGEDELTA_H
+#define IMAGEDELTA_H
+
+#include <QImage>
+#include <QPoint>
+#include <QVector>
+#include <functional>
+#include <memory>
+#include "undoscratchfile.h"
+
+/**
+ * @class ImageDelta
+ * @brief Undo storage for one edit: the other version of the changed tiles
+ *
+ * The document only ever holds one version of the image, the live one.
+ * A delta keeps what the live image would have to become to step across
+ * the edit: the pixels of the tiles (TileSize x TileSize) that differ
+ * between the two versions, taken from the version that is not live.
+ * swap() exchanges those tiles with the live image, so the same delta
+ * serves undo and redo and always stores a single version.
+ *
+ * Local edits (watermarks, small filters) cost only their changed tiles.
+ * When the edited area is known up front, the region constructor copies
+ * just the tiles under it before the edit, with no full-image compare.
+ * When the geometry or format changes, or when more than FullThreshold
+ * of the image changed, the whole other version is kept instead; it is
+ * swapped in O(1) and costs at most one image.
+ *
+ * spill() moves the stored pixels to an UndoScratchFile; the next swap()
+ * reads them back first, so spilling is invisible to the command. The
+ * serialization and compression run in a job that may go to a worker,
+ * completeSpill() then writes the result. The scratch block outlives the
+ * read: as long as the stored pixels are the ones it holds (an even
+ * number of swaps later), spilling again only drops them from memory.
+ */
+class ImageDelta
+{
+public:
+    static constexpr int TileSize = 128;
+    static constexpr double FullThreshold = 0.5;
+
+    // Empty delta, swap() does nothing
+    ImageDelta();
+
+    // Delta between the live image and the other version
+    ImageDelta(const QImage &other, const QImage &live);
+
+    // The tiles of the live image under region, taken before an edit that
+    // changes nothing outside region
+    ImageDelta(const QImage &live, const QRect &region);
+
+    // Exchange the stored version with the live image
+    void swap(QImage *live);
+
+    bool isEmpty() const { return !isResident() && !m_spill; }
+    bool isFull() const { return !m_full.isNull(); }
+    int tileCount() const { return m_tiles.size(); }
+
+    // Memory held by the stored pixels (0 while spilled)
+    qint64 bytes() const;
+
+    // Start moving the stored pixels to the scratch file. When the block of
+    // an earlier spill still holds them they are dropped at once and the
+    // job is empty; otherwise the job compresses a copy of them, and may run
+    // on any thread. Empty as well when there is nothing to spill.
+    std::function<void()> spill();
+
+    // Write the pixels compressed by the finished job and drop them; false
+    // if they stay in memory (no job, swapped since, write error)
+    bool completeSpill(const std::shared_ptr<UndoScratchFile> &scratch);
+
+    bool isSpilled() const { return m_spill && !isResident(); }
+    bool isSpillPending() const { return m_pendingSpill != nullptr; }
+
+    // The stored image of a full delta, read back first if spilled; null for tile deltas
+    QImage fullImage();
+
+    // The version swap() would produce, leaving the live image and the delta as they are
+    QImage applied(const QImage &live);
+
+    // Compressed size in the scratch file while spilled
+    qint64 spilledBytes() const;
+
+private:
+    struct Tile
+    {
+        QPoint origin;
+        QImage pixels;
+    };
+
+    // Scratch block, released when the last copy of the delta goes
+    struct SpilledBlock
+    {
+        std::shared_ptr<UndoScratchFile> file;
+        UndoScratchFile::Block block;
+
+        ~SpilledBlock() { file->release(block); }
+    };
+
+    // Copy of the stored pixels compressed by a spill() job
+    struct PendingSpill
+    {
+        QImage full;
+        QVector<Tile> tiles;
+        bool swapped;
+        QByteArray compressed;
+    };
+
+    static void copyTile(const QImage &source, const QPoint &origin, QImage *target,
+                         const QPoint &targetOrigin, const QSize &size);
+    bool pageIn();
+    bool isResident() const { return !m_full.isNull() || !m_tiles.isEmpty(); }
+
+    QImage m_full;
+    QVector<Tile> m_tiles;
+    std::shared_ptr<SpilledBlock> m_spill;
+    std::shared_ptr<PendingSpill> m_pendingSpill;
+
+    // Flips with every swap(); pixels taken with the same value are the same version
+    bool m_swapped = false;
+    bool m_spillSwapped = false;  // m_swapped when the block was written
+};
+
+#endif // IMAGEDELTA_H
@@ -0,0 +1,111 @@
+#include "undoscratchfile.h"
+#include "../logging/logger.h"
+#include <QDir>
+#include <iterator>
+
+UndoScratchFile::UndoScratchFile()
+    : m_file(QDir::tempPath() + "/pix3lforge_undo_XXXXXX")
+    , m_liveBytes(0)
+    , m_valid(false)
+{
+    m_valid = m_file.open();
+    if (!m_valid)
+        LOG_WARNING(QString("Undo scratch file unavailable: %1").arg(m_file.errorString()));
+}
+
+QByteArray UndoScratchFile::compress(const QByteArray &data)
+{
+    const QByteArray compressed = qCompress(data, 1);
+    if (compressed.isEmpty() && !data.isEmpty())
+        LOG_ERROR(QString("Undo scratch file cannot compress %1 bytes").arg(data.size()));
+    return compressed;
+}
+
+UndoScratchFile::Block UndoScratchFile::write(const QByteArray &compressed)
+{
+    Block block;
+    if (!m_valid || compressed.isEmpty())
+        return block;
+
+    const qint64 offset = allocate(compressed.size());
+    if (!m_file.seek(offset) || m_file.write(compressed) != compressed.size() || !m_file.flush()) {
+        LOG_ERROR(QString("Undo scratch file write failed: %1").arg(m_file.errorString()));
+        freeRange(offset, compressed.size());
+        return block;
+    }
+
+    block.offset = offset;
+    block.size = compressed.size();
+    m_liveBytes += block.size;
+    return block;
+}
+
+QByteArray UndoScratchFile::read(const Block &block)
+{
+    if (!m_valid || !block.isValid())
+        return QByteArray();
+
+    uchar *mapped = m_file.map(block.offset, block.size);
+    if (!mapped) {
+        LOG_ERROR(QString("Undo scratch file map failed: %1").arg(m_file.errorString()));
+        return QByteArray();
+    }
+
+    const QByteArray data = qUncompress(mapped, block.size);
+    m_file.unmap(mapped);
+    if (data.isEmpty())
+        LOG_ERROR("Undo scratch file block is corrupt");
+    return data;
+}
+
+qint64 UndoScratchFile::allocate(qint64 size)
+{
+    // Smallest released range that fits, the rest of it stays free
+    auto best = m_free.end();
+    for (auto it = m_free.begin(); it != m_free.end(); ++it) {
+        if (it.value() >= size && (best == m_free.end() || it.value() < best.value()))
+            best = it;
+    }
+    if (best == m_free.end())
+        return m_file.size();
+
+    const qint64 offset = best.key();
+    const qint64 remaining = best.value() - size;
+    m_free.erase(best);
+    if (remaining > 0)
+        m_free.insert(offset + size, remaining);
+    return offset;
+}
+
+void UndoScratchFile::release(const Block &block)
+{
+    if (!block.isValid())
+        return;
+
+    m_liveBytes = qMax<qint64>(0, m_liveBytes - block.size);
+    freeRange(block.offset, block.size);
+}
+
+void UndoScratchFile::freeRange(qint64 offset, qint64 size)
+{
+    // Merge with the free ranges on either side
+    auto next = m_free.lowerBound(offset);
+    if (next != m_free.end() && next.key() == offset + size) {
+        size += next.value();
+        next = m_free.erase(next);
+    }
+    if (next != m_free.begin()) {
+        auto previous = std::prev(next);
+        if (previous.key() + previous.value() == offset) {
+            offset = previous.key();
+            size += previous.value();
+            m_free.erase(previous);
+        }
+    }
+
+    // A free tail is given back to the file system
+    if (offset + size >= m_file.size())
+        m_file.resize(offset);
+    else
+        m_free.insert(offset, size);
+}
@@ -0,0 +1,59 @@
+#ifndef UNDOSCRATCHFILE_H
+#define UNDOSCRATCHFILE_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QTemporaryFile>
+
+/**
+ * @class UndoScratchFile
+ * @brief Temporary file holding undo snapshots evicted from memory
+ *
+ * Blocks are zlib-compressed (fastest level) by compress(), which may run
+ * on any thread, and decompressed straight from a memory mapping of their
+ * range when read back. Released ranges
+ * are merged with free neighbours and reused by later writes (smallest
+ * range that fits); a free range at the end of the file is truncated
+ * away. The file therefore stays about as large as the blocks still in
+ * use. It is removed when the object goes.
+ */
+class UndoScratchFile
+{
+public:
+    struct Block
+    {
+        qint64 offset = -1;
+        qint64 size = 0;
+
+        bool isValid() const { return offset >= 0; }
+    };
+
+    UndoScratchFile();
+
+    bool isValid() const { return m_valid; }
+
+    // zlib at the fastest level, thread-safe; empty on error
+    static QByteArray compress(const QByteArray &data);
+
+    // Store compress() output in a free range or at the end; invalid block on error
+    Block write(const QByteArray &compressed);
+
+    // Decompressed contents, empty on error
+    QByteArray read(const Block &block);
+
+    void release(const Block &block);
+
+    // Compressed bytes in blocks that were not released
+    qint64 liveBytes() const { return m_liveBytes; }
+
+private:
+    qint64 allocate(qint64 size);
+    void freeRange(qint64 offset, qint64 size);
+
+    QTemporaryFile m_file;
+    QMap<qint64, qint64> m_free;  // Released ranges inside the file, offset -> size
+    qint64 m_liveBytes;
+    bool m_valid;
+};
+
+#endif // UNDOSCRATCHFILE_H
@@ -145,11 +145,40 @@ std::optional<int> DialogManager::showBlurRadiusDialog()
 {
     bool ok;
     int radius = QInputDialog::getInt(m_parent, tr("Blur"),
-                                      tr("Set blur radius (1 to 10):"),
-                                      2, 1, 10, 1, &ok);
+                                      tr("Set blur radius (1 to 250):"),
+                                      2, 1, 250, 1, &ok);
     return ok ? std::optional<int>(radius) : std::nullopt;
 }
 
+QString DialogManager::showOpenLutDialog()
+{
+    return QFileDialog::getOpenFileName(m_parent, tr("Apply LUT"), QString(),
+                                        tr("Cube LUT (*.cube);;All Files (*)"));
+}
+
+std::optional<CustomKernelParams> DialogManager::showCustomKernelDialog(const QString &initialText)
+{
+    bool ok;
+    QString text = QInputDialog::getMultiLineText(m_parent, tr("Custom Kernel"),
+                                                  tr("One row of integer weights per line, odd size up to %1x%1.\n"
+                                                     "Optional lines: \"divisor N\" (default: sum of weights), \"bias N\".")
+                                                  .arg(ConvolutionKernel::MaxSize),
+                                                  initialText, &ok);
+    if (!ok) return std::nullopt;
+
+    const QList<Convolution::BorderMode> modes = { Convolution::Clamp, Convolution::Mirror, Convolution::Wrap };
+    QStringList names;
+    for (Convolution::BorderMode mode : modes)
+        names << Convolution::borderModeName(mode);
+
+    QString name = QInputDialog::getItem(m_parent, tr("Custom Kernel"),
+                                         tr("Pixels beyond the image border:"),
+                                         names, 0, false, &ok);
+    if (!ok) return std::nullopt;
+
+    return CustomKernelParams{text, modes.at(names.indexOf(name))};
+}
+
 std::optional<ResizeParams> DialogManager::showResizeDialog(int currentWidth, int currentHeight)
 {
     bool ok;
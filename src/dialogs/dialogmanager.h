@@ -5,6 +5,7 @@
 #include <QString>
 #include <QImage>
 #include <optional>
+#include "../processing/convolution.h"
 
 class QWidget;
 
@@ -48,6 +49,15 @@ struct ImageWatermarkParams {
     int y;
 };
 
+/**
+ * @struct CustomKernelParams
+ * @brief Parameters for a user-supplied convolution kernel
+ */
+struct CustomKernelParams {
+    QString kernelText;  // Parsed with ConvolutionKernel::fromText()
+    Convolution::BorderMode border;
+};
+
 /**
  * @class DialogManager
  * @brief Manages all user input dialogs and file operations
@@ -93,6 +103,8 @@ public:
 
     // Filter input dialogs
     std::optional<int> showBlurRadiusDialog();
+    QString showOpenLutDialog();
+    std::optional<CustomKernelParams> showCustomKernelDialog(const QString &initialText);
 
     // Transformation input dialogs
     std::optional<ResizeParams> showResizeDialog(int currentWidth, int currentHeight);
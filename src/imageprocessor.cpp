@@ -1,7 +1,17 @@
 #include "imageprocessor.h"
 #include "model/adjustmentparameters.h"
 #include "logging/logger.h"
+#include "processing/pixelkernels.h"
+#include "processing/imagebufferpool.h"
+#include "processing/adjustmentlut.h"
+#include "processing/adjustmentkernel.h"
+#include "processing/simdkernels.h"
+#include "processing/blurengine.h"
+#include "processing/convolution.h"
+#include "processing/statsaccumulator.h"
+#include "processing/parallelrows.h"
 #include <QColor>
+#include <QFontMetrics>
 #include <QPainter>
 #include <QtMath>
 
@@ -12,225 +22,182 @@ ImageProcessor::ImageProcessor(QObject *parent)
 
 // Basic adjustments
 QImage ImageProcessor::adjustBrightness(const QImage &image, int brightness)
+{
+    return adjustBrightness(PixelKernels::workingCopy(image), brightness);
+}
+
+QImage ImageProcessor::adjustBrightness(QImage &&image, int brightness)
 {
     if (image.isNull())
-        return image;
+        return std::move(image);
 
-    QImage result = image.copy();
     brightness = qBound(-100, brightness, 100);
 
-    for (int y = 0; y < result.height(); ++y) {
-        for (int x = 0; x < result.width(); ++x) {
-            QColor color = result.pixelColor(x, y);
-            int r = qBound(0, color.red() + brightness, 255);
-            int g = qBound(0, color.green() + brightness, 255);
-            int b = qBound(0, color.blue() + brightness, 255);
-            result.setPixelColor(x, y, QColor(r, g, b, color.alpha()));
-        }
-    }
-
-    return result;
+    return PixelKernels::mapRows(std::move(image), [brightness](QRgb *line, int, int width) {
+        SimdKernels::brightnessRow(line, width, brightness);
+    });
 }
 
 QImage ImageProcessor::adjustContrast(const QImage &image, int contrast)
+{
+    return adjustContrast(PixelKernels::workingCopy(image), contrast);
+}
+
+QImage ImageProcessor::adjustContrast(QImage &&image, int contrast)
 {
     if (image.isNull())
-        return image;
+        return std::move(image);
 
-    QImage result = image.copy();
     contrast = qBound(-100, contrast, 100);
     double factor = (259.0 * (contrast + 255)) / (255.0 * (259 - contrast));
 
-    for (int y = 0; y < result.height(); ++y) {
-        for (int x = 0; x < result.width(); ++x) {
-            QColor color = result.pixelColor(x, y);
-            int r = qBound(0, static_cast<int>(factor * (color.red() - 128) + 128), 255);
-            int g = qBound(0, static_cast<int>(factor * (color.green() - 128) + 128), 255);
-            int b = qBound(0, static_cast<int>(factor * (color.blue() - 128) + 128), 255);
-            result.setPixelColor(x, y, QColor(r, g, b, color.alpha()));
-        }
-    }
-
-    return result;
+    return PixelKernels::mapRows(std::move(image), [factor](QRgb *line, int, int width) {
+        SimdKernels::contrastRow(line, width, factor);
+    });
 }
 
 QImage ImageProcessor::adjustSaturation(const QImage &image, int saturation)
+{
+    return adjustSaturation(PixelKernels::workingCopy(image), saturation);
+}
+
+QImage ImageProcessor::adjustSaturation(QImage &&image, int saturation)
 {
     if (image.isNull())
-        return image;
+        return std::move(image);
 
-    QImage result = image.copy();
-    saturation = qBound(-100, saturation, 100);
-    double factor = 1.0 + saturation / 100.0;
-
-    for (int y = 0; y < result.height(); ++y) {
-        for (int x = 0; x < result.width(); ++x) {
-            QColor color = result.pixelColor(x, y);
-            QColor hsvColor = color.toHsv();
-            int s = qBound(0, static_cast<int>(hsvColor.saturation() * factor), 255);
-            hsvColor.setHsv(hsvColor.hue(), s, hsvColor.value(), hsvColor.alpha());
-            result.setPixelColor(x, y, hsvColor.toRgb());
-        }
-    }
+    const double factor = AdjustmentKernel::saturationFactor(saturation);
 
-    return result;
+    return PixelKernels::mapRows(std::move(image), [factor](QRgb *line, int, int width) {
+        AdjustmentKernel::saturateRow(line, width, factor);
+    });
 }
 
 QImage ImageProcessor::adjustHue(const QImage &image, int hue)
+{
+    return adjustHue(PixelKernels::workingCopy(image), hue);
+}
+
+QImage ImageProcessor::adjustHue(QImage &&image, int hue)
 {
     if (image.isNull())
-        return image;
+        return std::move(image);
 
-    QImage result = image.copy();
-    hue = qBound(-180, hue, 180);
-
-    for (int y = 0; y < result.height(); ++y) {
-        for (int x = 0; x < result.width(); ++x) {
-            QColor color = result.pixelColor(x, y);
-            QColor hsvColor = color.toHsv();
-            int h = (hsvColor.hue() + hue) % 360;
-            if (h < 0)
-                h += 360;
-            hsvColor.setHsv(h, hsvColor.saturation(), hsvColor.value(), hsvColor.alpha());
-            result.setPixelColor(x, y, hsvColor.toRgb());
-        }
-    }
+    const int offset = AdjustmentKernel::hueOffset(hue);
 
-    return result;
+    return PixelKernels::mapRows(std::move(image), [offset](QRgb *line, int, int width) {
+        AdjustmentKernel::rotateHueRow(line, width, offset);
+    });
 }
 
 QImage ImageProcessor::adjustGamma(const QImage &image, double gamma)
 {
-    if (image.isNull())
-        return image;
+    return adjustGamma(PixelKernels::workingCopy(image), gamma);
+}
 
-    QImage result = image.copy();
-    gamma = qBound(0.1, gamma, 10.0);
-
-    for (int y = 0; y < result.height(); ++y) {
-        for (int x = 0; x < result.width(); ++x) {
-            QColor color = result.pixelColor(x, y);
-            int r = qBound(0, static_cast<int>(255 * qPow(color.red() / 255.0, 1.0 / gamma)), 255);
-            int g = qBound(0, static_cast<int>(255 * qPow(color.green() / 255.0, 1.0 / gamma)), 255);
-            int b = qBound(0, static_cast<int>(255 * qPow(color.blue() / 255.0, 1.0 / gamma)), 255);
-            result.setPixelColor(x, y, QColor(r, g, b, color.alpha()));
-        }
-    }
+QImage ImageProcessor::adjustGamma(QImage &&image, double gamma)
+{
+    if (image.isNull())
+        return std::move(image);
 
-    return result;
+    return ChannelLut::gamma(gamma).apply(std::move(image));
 }
 
 // Color adjustments
 QImage ImageProcessor::adjustColorTemperature(const QImage &image, int temperature)
 {
-    if (image.isNull())
-        return image;
-
-    QImage result = image.copy();
-    temperature = qBound(-100, temperature, 100);
+    return adjustColorTemperature(PixelKernels::workingCopy(image), temperature);
+}
 
-    for (int y = 0; y < result.height(); ++y) {
-        for (int x = 0; x < result.width(); ++x) {
-            QColor color = result.pixelColor(x, y);
-            QColor adjustedColor = adjustColorTemperatureHelper(color, temperature);
-            result.setPixelColor(x, y, adjustedColor);
-        }
-    }
+QImage ImageProcessor::adjustColorTemperature(QImage &&image, int temperature)
+{
+    if (image.isNull())
+        return std::move(image);
 
-    return result;
+    return ChannelLut::colorTemperature(temperature).apply(std::move(image));
 }
 
-QColor ImageProcessor::adjustColorTemperatureHelper(const QColor &color, int temperature)
-{
-    QColor result = color;
-    if (temperature > 0) {
-        // Warmer (more red/yellow)
-        int r = result.red();
-        int g = qBound(0, result.green() - temperature / 2, 255);
-        int b = qBound(0, result.blue() - temperature, 255);
-        result.setRgb(r, g, b, result.alpha());
-    } else if (temperature < 0) {
-        // Cooler (more blue)
-        int r = qBound(0, result.red() + temperature, 255);
-        int g = qBound(0, result.green() + temperature / 2, 255);
-        int b = result.blue();
-        result.setRgb(r, g, b, result.alpha());
-    }
-    return result;
+QImage ImageProcessor::adjustExposure(const QImage &image, int exposure)
+{
+    return adjustExposure(PixelKernels::workingCopy(image), exposure);
 }
 
-QImage ImageProcessor::adjustExposure(const QImage &image, int exposure)
+QImage ImageProcessor::adjustExposure(QImage &&image, int exposure)
 {
     if (image.isNull())
-        return image;
+        return std::move(image);
 
-    QImage result = image.copy();
     exposure = qBound(-100, exposure, 100);
     double factor = qPow(2.0, exposure / 50.0);
 
-    for (int y = 0; y < result.height(); ++y) {
-        for (int x = 0; x < result.width(); ++x) {
-            QColor color = result.pixelColor(x, y);
-            int r = qBound(0, static_cast<int>(color.red() * factor), 255);
-            int g = qBound(0, static_cast<int>(color.green() * factor), 255);
-            int b = qBound(0, static_cast<int>(color.blue() * factor), 255);
-            result.setPixelColor(x, y, QColor(r, g, b, color.alpha()));
-        }
-    }
-
-    return result;
+    return PixelKernels::mapRows(std::move(image), [factor](QRgb *line, int, int width) {
+        SimdKernels::exposureRow(line, width, factor);
+    });
 }
 
 QImage ImageProcessor::adjustShadows(const QImage &image, int shadows)
+{
+    return adjustShadows(PixelKernels::workingCopy(image), shadows);
+}
+
+QImage ImageProcessor::adjustShadows(QImage &&image, int shadows)
 {
     if (image.isNull())
-        return image;
+        return std::move(image);
 
-    QImage result = image.copy();
-    shadows = qBound(-100, shadows, 100);
-    double factor = shadows / 100.0;
-
-    for (int y = 0; y < result.height(); ++y) {
-        for (int x = 0; x < result.width(); ++x) {
-            QColor color = result.pixelColor(x, y);
-            double luminance = (0.299 * color.red() + 0.587 * color.green() + 0.114 * color.blue()) / 255.0;
-            if (luminance < 0.5) { // Shadow areas
-                double shadowFactor = 1.0 + factor * (1.0 - luminance * 2.0);
-                int r = qBound(0, static_cast<int>(color.red() * shadowFactor), 255);
-                int g = qBound(0, static_cast<int>(color.green() * shadowFactor), 255);
-                int b = qBound(0, static_cast<int>(color.blue() * shadowFactor), 255);
-                result.setPixelColor(x, y, QColor(r, g, b, color.alpha()));
-            }
-        }
-    }
+    const double factor = AdjustmentKernel::toneFactor(shadows);
 
-    return result;
+    return PixelKernels::mapPixels(std::move(image), [factor](QRgb pixel) {
+        return AdjustmentKernel::liftShadows(pixel, factor);
+    });
 }
 
 QImage ImageProcessor::adjustHighlights(const QImage &image, int highlights)
+{
+    return adjustHighlights(PixelKernels::workingCopy(image), highlights);
+}
+
+QImage ImageProcessor::adjustHighlights(QImage &&image, int highlights)
 {
     if (image.isNull())
-        return image;
+        return std::move(image);
 
-    QImage result = image.copy();
-    highlights = qBound(-100, highlights, 100);
-    double factor = highlights / 100.0;
-
-    for (int y = 0; y < result.height(); ++y) {
-        for (int x = 0; x < result.width(); ++x) {
-            QColor color = result.pixelColor(x, y);
-            double luminance = (0.299 * color.red() + 0.587 * color.green() + 0.114 * color.blue()) / 255.0;
-            if (luminance > 0.5) { // Highlight areas
-                double highlightFactor = 1.0 - factor * (luminance * 2.0 - 1.0);
-                int r = qBound(0, static_cast<int>(color.red() * highlightFactor), 255);
-                int g = qBound(0, static_cast<int>(color.green() * highlightFactor), 255);
-                int b = qBound(0, static_cast<int>(color.blue() * highlightFactor), 255);
-                result.setPixelColor(x, y, QColor(r, g, b, color.alpha()));
-            }
-        }
-    }
+    const double factor = AdjustmentKernel::toneFactor(highlights);
 
-    return result;
+    return PixelKernels::mapPixels(std::move(image), [factor](QRgb pixel) {
+        return AdjustmentKernel::compressHighlights(pixel, factor);
+    });
+}
+
+// Adjustment chain
+QImage ImageProcessor::applyAdjustments(const QImage &image, const AdjustmentParameters &params)
+{
+    return applyAdjustments(PixelKernels::workingCopy(image), params);
+}
+
+QImage ImageProcessor::applyAdjustments(QImage &&image, const AdjustmentParameters &params)
+{
+    if (image.isNull())
+        return std::move(image);
+
+    // Per-channel stages are folded into at most two lookup tables, then
+    // every active stage runs in a single pass with no intermediate images
+    return AdjustmentKernel(m_lutCompiler.compile(params)).apply(std::move(image));
+}
+
+// 3D color LUTs
+ColorLut3D ImageProcessor::bakeAdjustments(const AdjustmentParameters &params, int lutSize)
+{
+    // Run the exact adjustment chain over the lattice points
+    return ColorLut3D::fromLatticeImage(applyAdjustments(ColorLut3D::latticeImage(lutSize), params), lutSize);
+}
+
+QImage ImageProcessor::applyColorLut(const QImage &image, const ColorLut3D &lut)
+{
+    if (image.isNull() || lut.isNull())
+        return image;
+
+    return lut.apply(image);
 }
 
 // Filters
@@ -248,19 +215,9 @@ QImage ImageProcessor::applySepia(const QImage &image)
     if (image.isNull())
         return image;
 
-    QImage result = image.copy();
-
-    for (int y = 0; y < result.height(); ++y) {
-        for (int x = 0; x < result.width(); ++x) {
-            QColor color = result.pixelColor(x, y);
-            int tr = qBound(0, static_cast<int>(0.393 * color.red() + 0.769 * color.green() + 0.189 * color.blue()), 255);
-            int tg = qBound(0, static_cast<int>(0.349 * color.red() + 0.686 * color.green() + 0.168 * color.blue()), 255);
-            int tb = qBound(0, static_cast<int>(0.272 * color.red() + 0.534 * color.green() + 0.131 * color.blue()), 255);
-            result.setPixelColor(x, y, QColor(tr, tg, tb, color.alpha()));
-        }
-    }
-
-    return result;
+    return PixelKernels::mapRows(image, [](QRgb *line, int, int width) {
+        SimdKernels::sepiaRow(line, width);
+    });
 }
 
 QImage ImageProcessor::applyVignette(const QImage &image)
@@ -268,27 +225,13 @@ QImage ImageProcessor::applyVignette(const QImage &image)
     if (image.isNull())
         return image;
 
-    QImage result = image.copy();
-    int centerX = result.width() / 2;
-    int centerY = result.height() / 2;
-    double radius = qMin(result.width(), result.height()) / 2.0;
-
-    for (int y = 0; y < result.height(); ++y) {
-        for (int x = 0; x < result.width(); ++x) {
-            double dx = x - centerX;
-            double dy = y - centerY;
-            double distance = qSqrt(dx * dx + dy * dy);
-            double factor = qBound(0.0, 1.0 - (distance / radius), 1.0);
-
-            QColor color = result.pixelColor(x, y);
-            int r = static_cast<int>(color.red() * factor);
-            int g = static_cast<int>(color.green() * factor);
-            int b = static_cast<int>(color.blue() * factor);
-            result.setPixelColor(x, y, QColor(r, g, b, color.alpha()));
-        }
-    }
+    int centerX = image.width() / 2;
+    int centerY = image.height() / 2;
+    double radius = qMin(image.width(), image.height()) / 2.0;
 
-    return result;
+    return PixelKernels::mapRows(image, [centerX, centerY, radius](QRgb *line, int y, int width) {
+        SimdKernels::vignetteRow(line, width, centerX, y - centerY, radius);
+    });
 }
 
 QImage ImageProcessor::applySharpen(const QImage &image)
@@ -296,36 +239,8 @@ QImage ImageProcessor::applySharpen(const QImage &image)
     if (image.isNull())
         return image;
 
-    // Create a copy for reading (source) and one for writing (result)
-    QImage source = image.copy();
-    QImage result = image.copy();
-
-    // Simple 3x3 sharpening kernel
-    int kernel[3][3] = {{0, -1, 0}, {-1, 5, -1}, {0, -1, 0}};
-
-    for (int y = 1; y < result.height() - 1; ++y) {
-        for (int x = 1; x < result.width() - 1; ++x) {
-            int r = 0, g = 0, b = 0;
-
-            for (int ky = -1; ky <= 1; ++ky) {
-                for (int kx = -1; kx <= 1; ++kx) {
-                    // Read from source (unmodified), not from result!
-                    QColor color = source.pixelColor(x + kx, y + ky);
-                    r += color.red() * kernel[ky + 1][kx + 1];
-                    g += color.green() * kernel[ky + 1][kx + 1];
-                    b += color.blue() * kernel[ky + 1][kx + 1];
-                }
-            }
-
-            r = qBound(0, r, 255);
-            g = qBound(0, g, 255);
-            b = qBound(0, b, 255);
-            // Keep original alpha channel
-            result.setPixelColor(x, y, QColor(r, g, b, source.pixelColor(x, y).alpha()));
-        }
-    }
-
-    return result;
+    // Simple 3x3 sharpening kernel, edge pixels repeated at the border
+    return Convolution::apply(image, ConvolutionKernel::sharpen(), Convolution::Clamp);
 }
 
 QImage ImageProcessor::applyBlur(const QImage &image, int radius)
@@ -349,57 +264,8 @@ QImage ImageProcessor::applyGaussianBlur(const QImage &image, int radius)
     if (image.isNull())
         return image;
 
-    radius = qBound(1, radius, 10);
-    QImage result = image.copy();
-
-    // Horizontal pass
-    for (int y = 0; y < result.height(); ++y) {
-        for (int x = 0; x < result.width(); ++x) {
-            int r = 0, g = 0, b = 0, a = 0, count = 0;
-
-            for (int kx = -radius; kx <= radius; ++kx) {
-                int nx = qBound(0, x + kx, result.width() - 1);
-                QColor color = result.pixelColor(nx, y);
-                r += color.red();
-                g += color.green();
-                b += color.blue();
-                a += color.alpha();
-                count++;
-            }
-
-            r /= count;
-            g /= count;
-            b /= count;
-            a /= count;
-            result.setPixelColor(x, y, QColor(r, g, b, a));
-        }
-    }
-
-    // Vertical pass
-    QImage temp = result.copy();
-    for (int y = 0; y < temp.height(); ++y) {
-        for (int x = 0; x < temp.width(); ++x) {
-            int r = 0, g = 0, b = 0, a = 0, count = 0;
-
-            for (int ky = -radius; ky <= radius; ++ky) {
-                int ny = qBound(0, y + ky, temp.height() - 1);
-                QColor color = temp.pixelColor(x, ny);
-                r += color.red();
-                g += color.green();
-                b += color.blue();
-                a += color.alpha();
-                count++;
-            }
-
-            r /= count;
-            g /= count;
-            b /= count;
-            a /= count;
-            result.setPixelColor(x, y, QColor(r, g, b, a));
-        }
-    }
-
-    return result;
+    // Three running-sum box passes, cost per pixel is independent of radius
+    return BlurEngine::gaussian(image, radius);
 }
 
 QImage ImageProcessor::applyEdgeDetection(const QImage &image)
@@ -407,29 +273,18 @@ QImage ImageProcessor::applyEdgeDetection(const QImage &image)
     if (image.isNull())
         return image;
 
-    QImage result = image.convertToFormat(QImage::Format_Grayscale8);
-    // Simple Sobel edge detection
-    int Gx[3][3] = {{-1, 0, 1}, {-2, 0, 2}, {-1, 0, 1}};
-    int Gy[3][3] = {{-1, -2, -1}, {0, 0, 0}, {1, 2, 1}};
-
-    for (int y = 1; y < result.height() - 1; ++y) {
-        for (int x = 1; x < result.width() - 1; ++x) {
-            int gx = 0, gy = 0;
-
-            for (int ky = -1; ky <= 1; ++ky) {
-                for (int kx = -1; kx <= 1; ++kx) {
-                    int intensity = qGray(result.pixel(x + kx, y + ky));
-                    gx += intensity * Gx[ky + 1][kx + 1];
-                    gy += intensity * Gy[ky + 1][kx + 1];
-                }
-            }
+    // Simple Sobel edge detection on the grayscale image
+    return Convolution::gradientMagnitude(image, ConvolutionKernel::sobelX(),
+                                         ConvolutionKernel::sobelY(), 4.0, Convolution::Clamp);
+}
 
-            int magnitude = qBound(0, static_cast<int>(qSqrt(gx * gx + gy * gy) / 4.0), 255);
-            result.setPixelColor(x, y, QColor(magnitude, magnitude, magnitude));
-        }
-    }
+QImage ImageProcessor::applyConvolution(const QImage &image, const ConvolutionKernel &kernel,
+                                        Convolution::BorderMode border)
+{
+    if (image.isNull() || kernel.isNull())
+        return image;
 
-    return result;
+    return Convolution::apply(image, kernel, border);
 }
 
 // Transformations
@@ -444,19 +299,29 @@ QImage ImageProcessor::rotate(const QImage &image, int angle)
 }
 
 QImage ImageProcessor::flipHorizontal(const QImage &image)
+{
+    return flipHorizontal(ImageBufferPool::copy(image));
+}
+
+QImage ImageProcessor::flipHorizontal(QImage &&image)
 {
     if (image.isNull())
-        return image;
+        return std::move(image);
 
-    return image.flipped(Qt::Horizontal);
+    return std::move(image).flipped(Qt::Horizontal);
 }
 
 QImage ImageProcessor::flipVertical(const QImage &image)
+{
+    return flipVertical(ImageBufferPool::copy(image));
+}
+
+QImage ImageProcessor::flipVertical(QImage &&image)
 {
     if (image.isNull())
-        return image;
+        return std::move(image);
 
-    return image.flipped(Qt::Vertical);
+    return std::move(image).flipped(Qt::Vertical);
 }
 
 QImage ImageProcessor::resize(const QImage &image, int width, int height)
@@ -482,12 +347,7 @@ QImage ImageProcessor::addTextWatermark(const QImage &image, const QString &text
         return image;
 
     QImage result = image.copy();
-    QPainter painter(&result);
-    painter.setPen(QColor(255, 255, 255, 128)); // Semi-transparent white
-    painter.setFont(QFont("Arial", 20));
-    painter.drawText(x, y, text);
-    painter.end();
-
+    paintTextWatermark(&result, text, x, y);
     return result;
 }
 
@@ -497,12 +357,52 @@ QImage ImageProcessor::addImageWatermark(const QImage &image, const QImage &wate
         return image;
 
     QImage result = image.copy();
-    QPainter painter(&result);
+    paintImageWatermark(&result, watermark, x, y);
+    return result;
+}
+
+static QFont watermarkFont()
+{
+    return QFont("Arial", 20);
+}
+
+void ImageProcessor::paintTextWatermark(QImage *image, const QString &text, int x, int y)
+{
+    if (!image || image->isNull() || text.isEmpty())
+        return;
+
+    QPainter painter(image);
+    painter.setPen(QColor(255, 255, 255, 128)); // Semi-transparent white
+    painter.setFont(watermarkFont());
+    painter.drawText(x, y, text);
+    painter.end();
+}
+
+void ImageProcessor::paintImageWatermark(QImage *image, const QImage &watermark, int x, int y)
+{
+    if (!image || image->isNull() || watermark.isNull())
+        return;
+
+    QPainter painter(image);
     painter.setOpacity(0.5); // Semi-transparent
     painter.drawImage(x, y, watermark);
     painter.end();
+}
 
-    return result;
+QRect ImageProcessor::textWatermarkRect(const QImage &image, const QString &text, int x, int y)
+{
+    if (text.isEmpty())
+        return QRect();
+
+    // Baseline at y; a margin covers antialiasing outside the glyph boxes.
+    // Measured at the image's DPI, which is what the painter draws at
+    const QFontMetrics metrics(watermarkFont(), &image);
+    return metrics.boundingRect(text).translated(x, y).adjusted(-2, -2, 2, 2);
+}
+
+QRect ImageProcessor::imageWatermarkRect(const QImage &watermark, int x, int y)
+{
+    return watermark.isNull() ? QRect() : QRect(QPoint(x, y), watermark.size());
 }
 
 // Auto-enhancement
@@ -518,52 +418,20 @@ ImageStats ImageProcessor::analyzeImage(const QImage &image)
     if (image.isNull())
         return stats;
 
-    // Calculate brightness, saturation, and count dark/bright pixels
-    double totalBrightness = 0;
-    double totalSaturation = 0;
-    int darkCount = 0;
-    int brightCount = 0;
-    int totalPixels = image.width() * image.height();
-
-    QVector<double> brightnessValues;
-    brightnessValues.reserve(totalPixels);
-
-    for (int y = 0; y < image.height(); ++y) {
-        for (int x = 0; x < image.width(); ++x) {
-            QColor color = image.pixelColor(x, y);
-
-            // Calculate brightness (luminance)
-            double brightness = 0.299 * color.red() + 0.587 * color.green() + 0.114 * color.blue();
-            totalBrightness += brightness;
-            brightnessValues.append(brightness);
-
-            // Count dark and bright pixels
-            if (brightness < 64) darkCount++;
-            if (brightness > 192) brightCount++;
-
-            // Calculate saturation
-            QColor hsvColor = color.toHsv();
-            totalSaturation += hsvColor.saturationF();
-        }
-    }
-
-    // Calculate average brightness
-    stats.averageBrightness = totalBrightness / totalPixels;
-
-    // Calculate contrast (standard deviation of brightness)
-    double variance = 0;
-    for (double brightness : brightnessValues) {
-        double diff = brightness - stats.averageBrightness;
-        variance += diff * diff;
-    }
-    stats.contrast = qSqrt(variance / totalPixels);
+    // One streaming pass: brightness mean/deviation, saturation and the
+    // dark/bright counts, with no per-pixel storage
+    const StatsAccumulator accumulator = StatsAccumulator::scan(image);
+    const qint64 totalPixels = accumulator.pixelCount();
+    if (totalPixels == 0)
+        return stats;
 
-    // Calculate average saturation
-    stats.saturation = totalSaturation / totalPixels;
+    stats.averageBrightness = accumulator.meanBrightness();
+    stats.contrast = accumulator.brightnessDeviation();
+    stats.saturation = accumulator.meanSaturation();
 
     // Calculate percentages
-    stats.darkPixels = (darkCount * 100) / totalPixels;
-    stats.brightPixels = (brightCount * 100) / totalPixels;
+    stats.darkPixels = static_cast<int>((accumulator.darkPixels() * 100) / totalPixels);
+    stats.brightPixels = static_cast<int>((accumulator.brightPixels() * 100) / totalPixels);
 
     return stats;
 }
@@ -575,14 +443,31 @@ QVector<int> ImageProcessor::calculateHistogram(const QImage &image)
     if (image.isNull())
         return histogram;
 
-    for (int y = 0; y < image.height(); ++y) {
-        for (int x = 0; x < image.width(); ++x) {
-            QColor color = image.pixelColor(x, y);
-            // Calculate luminance
-            int brightness = static_cast<int>(0.299 * color.red() + 0.587 * color.green() + 0.114 * color.blue());
-            histogram[brightness]++;
+    const QImage source = image.format() == PixelKernels::workingFormat(image)
+                          ? image
+                          : image.convertToFormat(PixelKernels::workingFormat(image));
+    const int width = source.width();
+
+    // One partial histogram per band, summed afterwards (integer counts, so
+    // the result does not depend on the band layout)
+    const QVector<ParallelRows::Band> bands = ParallelRows::split(source.height(), width);
+    QVector<int> partials(bands.size() * 256, 0);
+    int *partialData = partials.data();
+    ParallelRows::run(bands, [&](const ParallelRows::Band &band) {
+        int *counts = partialData + band.index * 256;
+        for (int y = band.begin; y < band.end; ++y) {
+            const QRgb *line = reinterpret_cast<const QRgb *>(source.constScanLine(y));
+            for (int x = 0; x < width; ++x) {
+                const QRgb pixel = line[x];
+                // Calculate luminance
+                int brightness = static_cast<int>(0.299 * qRed(pixel) + 0.587 * qGreen(pixel) + 0.114 * qBlue(pixel));
+                counts[brightness]++;
+            }
         }
-    }
+    });
+
+    for (int i = 0; i < partials.size(); ++i)
+        histogram[i % 256] += partials[i];
 
     return histogram;
 }
@@ -4,8 +4,9 @@
 #include <QImage>
 #include <QObject>
 #include <QVector>
-
-struct AdjustmentParameters;
+#include "processing/adjustmentlut.h"
+#include "processing/colorlut3d.h"
+#include "processing/convolution.h"
 
 /**
  * @struct ImageStats
@@ -27,18 +28,39 @@ class ImageProcessor : public QObject
 public:
     explicit ImageProcessor(QObject *parent = nullptr);
 
+    // The QImage&& overloads work in the buffer of an image the caller gives
+    // up when nothing else shares it: result = adjustX(std::move(result), ...)
+    // allocates no new image (it still copies if the buffer is shared)
+
     // Basic adjustments
     QImage adjustBrightness(const QImage &image, int brightness);
+    QImage adjustBrightness(QImage &&image, int brightness);
     QImage adjustContrast(const QImage &image, int contrast);
+    QImage adjustContrast(QImage &&image, int contrast);
     QImage adjustSaturation(const QImage &image, int saturation);
+    QImage adjustSaturation(QImage &&image, int saturation);
     QImage adjustHue(const QImage &image, int hue);
+    QImage adjustHue(QImage &&image, int hue);
     QImage adjustGamma(const QImage &image, double gamma);
+    QImage adjustGamma(QImage &&image, double gamma);
 
     // Color adjustments
     QImage adjustColorTemperature(const QImage &image, int temperature);
+    QImage adjustColorTemperature(QImage &&image, int temperature);
     QImage adjustExposure(const QImage &image, int exposure);
+    QImage adjustExposure(QImage &&image, int exposure);
     QImage adjustShadows(const QImage &image, int shadows);
+    QImage adjustShadows(QImage &&image, int shadows);
     QImage adjustHighlights(const QImage &image, int highlights);
+    QImage adjustHighlights(QImage &&image, int highlights);
+
+    // Full adjustment chain in PreviewManager order, all stages fused into one pass
+    QImage applyAdjustments(const QImage &image, const AdjustmentParameters &params);
+    QImage applyAdjustments(QImage &&image, const AdjustmentParameters &params);
+
+    // 3D color LUTs
+    ColorLut3D bakeAdjustments(const AdjustmentParameters &params, int lutSize = ColorLut3D::DefaultSize);
+    QImage applyColorLut(const QImage &image, const ColorLut3D &lut);
 
     // Filters
     QImage applyBlackAndWhite(const QImage &image);
@@ -48,11 +70,15 @@ public:
     QImage applyBlur(const QImage &image, int radius);
     QImage applyGaussianBlur(const QImage &image, int radius);
     QImage applyEdgeDetection(const QImage &image);
+    QImage applyConvolution(const QImage &image, const ConvolutionKernel &kernel,
+                            Convolution::BorderMode border = Convolution::Clamp);
 
     // Transformations
     QImage rotate(const QImage &image, int angle);
     QImage flipHorizontal(const QImage &image);
+    QImage flipHorizontal(QImage &&image);
     QImage flipVertical(const QImage &image);
+    QImage flipVertical(QImage &&image);
     QImage resize(const QImage &image, int width, int height);
     QImage crop(const QImage &image, int x, int y, int width, int height);
 
@@ -60,15 +86,20 @@ public:
     QImage addTextWatermark(const QImage &image, const QString &text, int x, int y);
     QImage addImageWatermark(const QImage &image, const QImage &watermark, int x, int y);
 
+    // Paint a watermark into the image itself; only the watermark rect changes
+    void paintTextWatermark(QImage *image, const QString &text, int x, int y);
+    void paintImageWatermark(QImage *image, const QImage &watermark, int x, int y);
+    static QRect textWatermarkRect(const QImage &image, const QString &text, int x, int y);
+    static QRect imageWatermarkRect(const QImage &watermark, int x, int y);
+
     // Auto-enhancement
     ImageStats analyzeImage(const QImage &image);
     QVector<int> calculateHistogram(const QImage &image);
     AdjustmentParameters suggestEnhancements(const ImageStats &stats);
 
 private:
-    // Helper functions
-    QColor adjustColorTemperatureHelper(const QColor &color, int temperature);
-    QColor adjustHueHelper(const QColor &color, int hue);
+    // Cached lookup tables for applyAdjustments()
+    AdjustmentLutCompiler m_lutCompiler;
 };
 
 #endif // IMAGEPROCESSOR_H
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "mainwindow.h"
 #include "logging/logger.h"
 #include "pix3ltheme.h"
+#include "processing/simdkernels.h"
+#include "processing/parallelrows.h"
 #include <QApplication>
 
 /**
@@ -99,6 +101,8 @@ int main(int argc, char *argv[])
 
     Logger::instance().info("=== Pix3lForge starting ===", "main");
     Logger::instance().info(QString("Version: %1").arg(QApplication::applicationVersion()), "main");
+    Logger::instance().info(QString("Pixel kernels: %1").arg(SimdKernels::report()), "main");
+    Logger::instance().info(QString("Processing threads: %1").arg(ParallelRows::threadCount()), "main");
 
     // Install custom message handler to redirect all qDebug/qInfo/qWarning/qCritical to Logger
     // This suppresses console output - use LogViewerDialog (Help → View Logs) to view logs
@@ -20,6 +20,12 @@
 #include <QtSvg/QSvgRenderer>
 #include <QTemporaryFile>
 
+// Longest side of the pyramid level auto-enhance analyzes
+static constexpr int AnalysisDimension = 1024;
+
+// Longest side of the pyramid level uploaded for AI analysis
+static constexpr int AIUploadDimension = 2048;
+
 MainWindow::MainWindow()
     : imageLabel(new QLabel)
     , scrollArea(new QScrollArea)
@@ -30,7 +36,6 @@ MainWindow::MainWindow()
     , propertiesPanel(nullptr)
     , undoView(nullptr)
     , placeholderWidget(nullptr)
-    , isProcessing(false)
 {
     // Enable drag and drop
     setAcceptDrops(true);
@@ -119,6 +124,13 @@ MainWindow::MainWindow()
 
     // Create actions through ActionManager
     actionManager->createAllActions();
+    previewManager->setColorLutPreview(SettingsManager::instance()->colorLutPreview());
+    connect(previewManager, &PreviewManager::previewReady, this, &MainWindow::onPreviewReady);
+
+    // Cached previews belong to the image they were rendered from; commands
+    // edit the image in place without imageChanged, the undo index tells
+    connect(document, &ImageDocument::imageChanged, previewManager, &PreviewManager::clearCache);
+    connect(commandManager, &CommandManager::indexChanged, previewManager, &PreviewManager::clearCache);
 
     createMenus();
     createToolBars();
@@ -131,6 +143,11 @@ MainWindow::MainWindow()
         actionManager->zoomOutAction()->setEnabled(canZoomOut);
     });
 
+    // Images are shown at display size, pick them again when that changes
+    connect(viewManager, &ViewManager::scaleFactorChanged, this, &MainWindow::refreshDisplayedImage);
+    connect(viewManager, &ViewManager::fitToWindowChanged, this, &MainWindow::refreshDisplayedImage);
+    connect(document, &ImageDocument::pyramidReady, this, &MainWindow::refreshDisplayedImage);
+
     // Restore window geometry from settings (or use default size if first run)
     QByteArray savedGeometry = SettingsManager::instance()->windowGeometry();
     if (!savedGeometry.isEmpty()) {
@@ -210,6 +227,7 @@ void MainWindow::createDockWidgets(QHBoxLayout *mainLayout)
     connect(commandManager, &CommandManager::canRedoChanged, this, [this](bool canRedo) {
         actionManager->redoAction()->setEnabled(canRedo);
     });
+    connect(commandManager, &CommandManager::historyNavigated, this, &MainWindow::onHistoryNavigated);
     connect(commandManager, &CommandManager::indexChanged, this, &MainWindow::updateImageDisplay);
 }
 
@@ -218,76 +236,44 @@ QImage MainWindow::applyCurrentAdjustments(const QImage &sourceImage)
     if (sourceImage.isNull() || !propertiesPanel)
         return sourceImage;
 
-    QImage result = sourceImage;
-
-    // Apply adjustments in sequence
-    int brightness = propertiesPanel->getBrightness();
-    if (brightness != 0)
-        result = imageProcessor->adjustBrightness(result, brightness);
-
-    int contrast = propertiesPanel->getContrast();
-    if (contrast != 0)
-        result = imageProcessor->adjustContrast(result, contrast);
-
-    int saturation = propertiesPanel->getSaturation();
-    if (saturation != 0)
-        result = imageProcessor->adjustSaturation(result, saturation);
-
-    int hue = propertiesPanel->getHue();
-    if (hue != 0)
-        result = imageProcessor->adjustHue(result, hue);
-
-    double gamma = propertiesPanel->getGamma();
-    if (qAbs(gamma - 1.0) > 0.01)
-        result = imageProcessor->adjustGamma(result, gamma);
-
-    int temperature = propertiesPanel->getColorTemperature();
-    if (temperature != 0)
-        result = imageProcessor->adjustColorTemperature(result, temperature);
-
-    int exposure = propertiesPanel->getExposure();
-    if (exposure != 0)
-        result = imageProcessor->adjustExposure(result, exposure);
-
-    int shadows = propertiesPanel->getShadows();
-    if (shadows != 0)
-        result = imageProcessor->adjustShadows(result, shadows);
-
-    int highlights = propertiesPanel->getHighlights();
-    if (highlights != 0)
-        result = imageProcessor->adjustHighlights(result, highlights);
-
-    return result;
+    return previewManager->generatePreview(sourceImage, propertiesPanel->getAdjustments());
 }
 
-// Get preview-sized version for faster processing
-QImage MainWindow::getPreviewImage(const QImage &sourceImage)
+// Live preview slots
+void MainWindow::onLivePreviewBrightness(int value)
 {
-    return previewManager->getOptimizedPreviewSource(sourceImage);
+    if (!document->isEmpty() && propertiesPanel) {
+        // Use current image as base (so preview works after undo/redo).
+        // Rendered on a worker thread, onPreviewReady() shows the result.
+        // Frames come at display resolution from the smallest pyramid level
+        // that covers it, full resolution only from 100% zoom.
+        const QSize displaySize = viewManager->previewSize();
+        previewManager->requestPreview(document->pyramidLevel(displaySize),
+                                       propertiesPanel->getAdjustments(), displaySize);
+    }
 }
 
-// Live preview slots
-void MainWindow::onLivePreviewBrightness(int value)
+void MainWindow::refreshDisplayedImage()
 {
-    if (!document->isEmpty() && !isProcessing) {
-        isProcessing = true;
+    if (document->isEmpty())
+        return;
 
-        // Use current image as base (so preview works after undo/redo)
-        QImage previewSource = getPreviewImage(document->getCurrentImage());
-        QImage adjustedPreview = applyCurrentAdjustments(previewSource);
+    if (propertiesPanel && propertiesPanel->getAdjustments().hasAnyAdjustments()) {
+        onLivePreviewBrightness(0);
+        return;
+    }
 
-        // Scale back to display size if needed
-        if (previewSource.size() != document->getCurrentImage().size()) {
-            adjustedPreview = adjustedPreview.scaled(document->getCurrentImage().size(),
-                                                     Qt::KeepAspectRatio,
-                                                     Qt::SmoothTransformation);
-        }
+    // Zoomed out, the label would otherwise downscale the full image on every paint
+    viewManager->displayPreview(document->pyramidLevel(viewManager->previewSize()));
+}
 
-        previewImage = adjustedPreview;
-        imageLabel->setPixmap(QPixmap::fromImage(previewImage));
+void MainWindow::onPreviewReady(const QImage &preview)
+{
+    if (document->isEmpty())
+        return;
 
-        isProcessing = false;
-    }
+    previewImage = preview;
+    viewManager->displayPreview(previewImage);
 }
 
 void MainWindow::onLivePreviewContrast(int value)
@@ -337,6 +323,7 @@ void MainWindow::onApplyAdjustments()
 
     // Get all adjustments from properties panel
     AdjustmentParameters params = propertiesPanel->getAdjustments();
+    previewManager->cancelPreview();
 
     // Create compound command using factory
     CompoundAdjustmentCommand *compoundCmd = CommandFactory::createCompoundAdjustmentCommand(
@@ -353,24 +340,39 @@ void MainWindow::onApplyAdjustments()
 
 void MainWindow::onResetAdjustments()
 {
+    previewManager->cancelPreview();
     if (!document->getCurrentImage().isNull()) {
-        imageLabel->setPixmap(QPixmap::fromImage(document->getCurrentImage()));
+        viewManager->displayPreview(document->getCurrentImage());
         previewImage = document->getCurrentImage();
     }
 }
 
 void MainWindow::updateImageDisplay()
 {
-    if (!document->isEmpty()) {
-        viewManager->displayImage(document->getCurrentImage());
-        previewImage = document->getCurrentImage();
-        updateActions();
+    if (document->isEmpty()) {
+        previewManager->cancelPreview();
+        return;
+    }
 
-        // Reset properties panel after undo/redo to avoid confusion
-        if (propertiesPanel) {
-            propertiesPanel->resetAll();
-        }
+    previewImage = document->getCurrentImage();
+    updateActions();
+
+    // A command that finished in the background keeps the slider values set
+    // while it computed: the live preview is rendered again on the new image
+    if (propertiesPanel && propertiesPanel->getAdjustments().hasAnyAdjustments()) {
+        onLivePreviewBrightness(0);
+        return;
     }
+
+    previewManager->cancelPreview();
+    viewManager->displayImage(document->getCurrentImage());
+}
+
+void MainWindow::onHistoryNavigated()
+{
+    // Reset properties panel after undo/redo to avoid confusion
+    if (propertiesPanel)
+        propertiesPanel->resetAll();
 }
 
 bool MainWindow::loadFile(const QString &fileName)
@@ -385,8 +387,8 @@ bool MainWindow::loadFile(const QString &fileName)
         return false;
     }
 
+    previewManager->cancelPreview();
     previewImage = document->getCurrentImage();
-    previewSourceImage = getPreviewImage(document->getCurrentImage()); // Precalculate for speed
     viewManager->displayImage(document->getCurrentImage());
     viewManager->reset();
 
@@ -427,6 +429,8 @@ void MainWindow::open()
 
 void MainWindow::save()
 {
+    commandManager->finishPendingCommands();
+
     if (document->filePath().isEmpty()) {
         saveAs();
     } else {
@@ -445,6 +449,7 @@ void MainWindow::saveAs()
     QString fileName = dialogManager->showSaveFileDialog(&quality);
 
     if (!fileName.isEmpty()) {
+        commandManager->finishPendingCommands();
         if (!document->saveAs(fileName)) {
             dialogManager->showError(tr("Save Error"),
                                      tr("Cannot save image to %1").arg(fileName));
@@ -472,8 +477,8 @@ void MainWindow::autoEnhance()
 
     LOG_INFO("Auto-enhance started");
 
-    // Analyze the current image
-    ImageStats stats = imageProcessor->analyzeImage(document->getCurrentImage());
+    // Analyze the current image, statistics need no more than a reduced level
+    ImageStats stats = imageProcessor->analyzeImage(document->pyramidLevel(AnalysisDimension));
 
     // Get suggested enhancements
     AdjustmentParameters params = imageProcessor->suggestEnhancements(stats);
@@ -679,6 +684,54 @@ void MainWindow::applyEdgeDetection()
     }
 }
 
+void MainWindow::applyCustomKernel()
+{
+    if (document->isEmpty()) return;
+
+    auto params = dialogManager->showCustomKernelDialog(ConvolutionKernel::sharpen().toText());
+    if (!params)
+        return;
+
+    QString error;
+    ConvolutionKernel kernel = ConvolutionKernel::fromText(params->kernelText, &error);
+    if (kernel.isNull()) {
+        LOG_ERROR(QString("Invalid custom kernel: %1").arg(error));
+        dialogManager->showError(tr("Kernel Error"), error);
+        return;
+    }
+
+    LOG_INFO(QString("Applying %1x%2 custom kernel (%3, %4)")
+             .arg(kernel.width()).arg(kernel.height())
+             .arg(kernel.isSeparable() ? "separable" : "non-separable")
+             .arg(Convolution::borderModeName(params->border)));
+    ConvolutionCommand *cmd = CommandFactory::createConvolutionCommand(document->currentImagePtr(),
+                                                                       kernel, params->border);
+    commandManager->executeCommand(cmd);
+    statusBar()->showMessage(tr("Applied %1x%2 custom kernel").arg(kernel.width()).arg(kernel.height()), 2000);
+}
+
+void MainWindow::applyColorLut()
+{
+    if (document->isEmpty()) return;
+
+    QString fileName = dialogManager->showOpenLutDialog();
+    if (fileName.isEmpty())
+        return;
+
+    QString error;
+    ColorLut3D lut = ColorLut3D::loadCube(fileName, &error);
+    if (lut.isNull()) {
+        LOG_ERROR(QString("Failed to load LUT %1: %2").arg(fileName, error));
+        dialogManager->showError(tr("LUT Error"), error);
+        return;
+    }
+
+    LOG_INFO(QString("Applying LUT %1 (%2^3)").arg(lut.title()).arg(lut.size()));
+    ColorLutCommand *cmd = CommandFactory::createColorLutCommand(document->currentImagePtr(), lut);
+    commandManager->executeCommand(cmd);
+    statusBar()->showMessage(tr("Applied LUT %1").arg(lut.title()), 2000);
+}
+
 // Transformations using undo commands
 void MainWindow::rotate90()
 {
@@ -816,12 +869,15 @@ void MainWindow::aiEnhance()
         return;
     }
 
-    // If the current image has been modified, save it to a temporary file
+    // Upload a reduced pyramid level, or the current image if it has been
+    // modified; only an unmodified image small enough is sent as its file
     QString imagePath;
     QTemporaryFile* tempFile = nullptr;
+    const QImage uploadImage = document->pyramidLevel(AIUploadDimension);
 
-    if (document->isModified()) {
-        LOG_INFO("AI Enhancement: Saving modified image to temp file");
+    if (document->isModified() || uploadImage.size() != document->getCurrentImage().size()) {
+        LOG_INFO(QString("AI Enhancement: Saving %1x%2 image to temp file")
+                 .arg(uploadImage.width()).arg(uploadImage.height()));
         tempFile = new QTemporaryFile(QDir::tempPath() + "/pix3lforge_ai_XXXXXX.png");
         if (!tempFile->open()) {
             LOG_ERROR("AI Enhancement: Failed to create temp file");
@@ -831,7 +887,7 @@ void MainWindow::aiEnhance()
             return;
         }
         imagePath = tempFile->fileName();
-        if (!document->getCurrentImage().save(imagePath, "PNG")) {
+        if (!uploadImage.save(imagePath, "PNG")) {
             LOG_ERROR(QString("AI Enhancement: Failed to save temp file: %1").arg(imagePath));
             QMessageBox::critical(this, tr("Error"),
                                   tr("Failed to save temporary file for AI analysis."));
@@ -904,90 +960,129 @@ void MainWindow::applyAIEnhancements(const QList<ImageEnhancementSuggestion>& su
 
     LOG_INFO(QString("AI Enhancement: Applying %1 suggestions").arg(suggestions.count()));
 
+    // Point adjustments fold into fused passes, neighborhood filters follow
+    // in their order; the whole set is a single undoable step. A repeated
+    // operation adds up in the same pass only where that equals applying it
+    // twice (brightness of one sign, hue, gamma); other repeats start a new pass
+    QVector<AdjustmentParameters> passes(1);
+    QVector<PipelineCommand::Filter> filters;
     int appliedCount = 0;
 
+    auto passFor = [&passes](bool repeated) -> AdjustmentParameters & {
+        if (repeated)
+            passes.append(AdjustmentParameters());
+        return passes.last();
+    };
+
     for (const ImageEnhancementSuggestion& suggestion : suggestions) {
         QString operation = suggestion.operation.toLower();
         double value = suggestion.value;
+        const int amount = static_cast<int>(value);
 
         LOG_INFO(QString("AI Enhancement: Applying %1=%2 (confidence=%3, reason=%4)")
                  .arg(operation).arg(value)
                  .arg(suggestion.confidence).arg(suggestion.reason));
 
-        // Map AI suggestions to appropriate commands
+        // Map AI suggestions to pipeline steps; a zero offset changes nothing
         if (operation == "brightness") {
-            BrightnessCommand *cmd = CommandFactory::createBrightnessCommand(
-                document->currentImagePtr(), static_cast<int>(value));
-            commandManager->executeCommand(cmd);
-            appliedCount++;
+            if (amount != 0) {
+                // Offsets of one sign clamp the same either way
+                const int current = passes.last().brightness;
+                const bool adds = current == 0
+                    || ((current > 0) == (amount > 0) && qAbs(current + amount) <= 100);
+                AdjustmentParameters &pass = passFor(!adds);
+                pass.brightness = qBound(-100, pass.brightness + amount, 100);
+                appliedCount++;
+            }
         }
         else if (operation == "contrast") {
-            ContrastCommand *cmd = CommandFactory::createContrastCommand(
-                document->currentImagePtr(), static_cast<int>(value));
-            commandManager->executeCommand(cmd);
-            appliedCount++;
+            if (amount != 0) {
+                AdjustmentParameters &pass = passFor(passes.last().contrast != 0);
+                pass.contrast = qBound(-100, amount, 100);
+                appliedCount++;
+            }
         }
         else if (operation == "saturation") {
-            SaturationCommand *cmd = CommandFactory::createSaturationCommand(
-                document->currentImagePtr(), static_cast<int>(value));
-            commandManager->executeCommand(cmd);
-            appliedCount++;
+            if (amount != 0) {
+                AdjustmentParameters &pass = passFor(passes.last().saturation != 0);
+                pass.saturation = qBound(-100, amount, 100);
+                appliedCount++;
+            }
         }
         else if (operation == "hue") {
-            HueCommand *cmd = CommandFactory::createHueCommand(
-                document->currentImagePtr(), static_cast<int>(value));
-            commandManager->executeCommand(cmd);
-            appliedCount++;
+            if (amount != 0) {
+                // Rotations add up modulo a full turn
+                int hue = (passes.last().hue + amount) % 360;
+                if (hue > 180)
+                    hue -= 360;
+                else if (hue < -180)
+                    hue += 360;
+                passes.last().hue = hue;
+                appliedCount++;
+            }
         }
         else if (operation == "gamma") {
-            GammaCommand *cmd = CommandFactory::createGammaCommand(
-                document->currentImagePtr(), value);
-            commandManager->executeCommand(cmd);
-            appliedCount++;
+            if (value > 0 && !qFuzzyCompare(value, 1.0)) {
+                AdjustmentParameters &pass = passes.last();
+                pass.gamma = qBound(0.1, pass.gamma * value, 10.0);
+                appliedCount++;
+            }
         }
         else if (operation == "temperature" || operation == "color_temperature") {
-            ColorTemperatureCommand *cmd = CommandFactory::createColorTemperatureCommand(
-                document->currentImagePtr(), static_cast<int>(value));
-            commandManager->executeCommand(cmd);
-            appliedCount++;
+            if (amount != 0) {
+                AdjustmentParameters &pass = passFor(passes.last().temperature != 0);
+                pass.temperature = qBound(-100, amount, 100);
+                appliedCount++;
+            }
         }
         else if (operation == "exposure") {
-            ExposureCommand *cmd = CommandFactory::createExposureCommand(
-                document->currentImagePtr(), static_cast<int>(value));
-            commandManager->executeCommand(cmd);
-            appliedCount++;
+            if (amount != 0) {
+                AdjustmentParameters &pass = passFor(passes.last().exposure != 0);
+                pass.exposure = qBound(-100, amount, 100);
+                appliedCount++;
+            }
         }
         else if (operation == "shadows") {
-            ShadowsCommand *cmd = CommandFactory::createShadowsCommand(
-                document->currentImagePtr(), static_cast<int>(value));
-            commandManager->executeCommand(cmd);
-            appliedCount++;
+            if (amount != 0) {
+                AdjustmentParameters &pass = passFor(passes.last().shadows != 0);
+                pass.shadows = qBound(-100, amount, 100);
+                appliedCount++;
+            }
         }
         else if (operation == "highlights") {
-            HighlightsCommand *cmd = CommandFactory::createHighlightsCommand(
-                document->currentImagePtr(), static_cast<int>(value));
-            commandManager->executeCommand(cmd);
-            appliedCount++;
+            if (amount != 0) {
+                AdjustmentParameters &pass = passFor(passes.last().highlights != 0);
+                pass.highlights = qBound(-100, amount, 100);
+                appliedCount++;
+            }
         }
         else if (operation == "sharpen") {
-            FilterCommand *cmd = new FilterCommand(document->currentImagePtr(),
-                                                    FilterCommand::Sharpen);
-            commandManager->executeCommand(cmd);
-            appliedCount++;
+            // 0 means none; the sharpen kernel is fixed, the value is not a radius
+            if (amount > 0) {
+                filters.append({PipelineCommand::Filter::Sharpen, 0});
+                appliedCount++;
+            }
         }
         else if (operation == "blur") {
-            // Use value as blur radius (clamp to reasonable range)
-            int radius = qBound(1, static_cast<int>(value), 100);
-            BlurCommand *cmd = CommandFactory::createBlurCommand(
-                document->currentImagePtr(), radius);
-            commandManager->executeCommand(cmd);
-            appliedCount++;
+            // Use value as blur radius (clamp to reasonable range); it is a
+            // 0-100 strength in the prompt, not pixels of the uploaded image
+            if (amount > 0) {
+                int radius = qBound(1, amount, 100);
+                filters.append({PipelineCommand::Filter::Blur, radius});
+                appliedCount++;
+            }
         }
         else {
             LOG_WARNING(QString("AI Enhancement: Unknown operation '%1', skipping").arg(operation));
         }
     }
 
+    if (passes.last().hasAnyAdjustments() || passes.size() > 1 || !filters.isEmpty()) {
+        PipelineCommand *cmd = CommandFactory::createPipelineCommand(
+            document->currentImagePtr(), passes, filters, tr("AI Enhancement"));
+        commandManager->executeCommand(cmd);
+    }
+
     LOG_INFO(QString("AI Enhancement: Applied %1 of %2 suggestions")
              .arg(appliedCount).arg(suggestions.count()));
 
@@ -1018,6 +1113,17 @@ void MainWindow::fitToWindow()
     updateActions();
 }
 
+void MainWindow::toggleColorLutPreview()
+{
+    bool enabled = actionManager->colorLutPreviewAction()->isChecked();
+    previewManager->setColorLutPreview(enabled);
+    SettingsManager::instance()->setColorLutPreview(enabled);
+
+    // Re-render the current preview in the new mode
+    if (propertiesPanel && propertiesPanel->getAdjustments().hasAnyAdjustments())
+        onLivePreviewBrightness(0);
+}
+
 
 void MainWindow::createMenus()
 {
@@ -1060,12 +1166,12 @@ void MainWindow::createMenus()
     // Filter menu
     QMenu *filterMenu = menuBar()->addMenu(tr("&Filter"));
     filterMenu->addSection(tr("Creative Filters"));
-    for (int i = 0; i < 3; ++i) {
+    for (int i = 0; i < 4; ++i) {
         filterMenu->addAction(filterActions[i]);
     }
     filterMenu->addSeparator();
     filterMenu->addSection(tr("Enhancement"));
-    for (int i = 3; i < filterActions.size(); ++i) {
+    for (int i = 4; i < filterActions.size(); ++i) {
         filterMenu->addAction(filterActions[i]);
     }
 
@@ -1147,8 +1253,8 @@ void MainWindow::createToolBars()
 
     // Filters group
     mainToolBar->addAction(filterActions[0]); // Black & White
-    mainToolBar->addAction(filterActions[3]); // Sharpen
-    mainToolBar->addAction(filterActions[4]); // Blur
+    mainToolBar->addAction(filterActions[4]); // Sharpen
+    mainToolBar->addAction(filterActions[5]); // Blur
 
     // Separator
     mainToolBar->addSeparator();
@@ -1171,6 +1277,44 @@ void MainWindow::createToolBars()
 void MainWindow::createStatusBar()
 {
     statusBar()->showMessage(tr("Ready"));
+
+    // Undo history: how much is held in memory and how much was spilled to disk
+    QLabel *historyLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(historyLabel);
+    connect(commandManager, &CommandManager::historyMemoryChanged, historyLabel,
+            [historyLabel](qint64 residentBytes, qint64 spilledBytes) {
+        const QLocale locale;
+        historyLabel->setText(tr("History: %1 in memory, %2 on disk")
+                              .arg(locale.formattedDataSize(residentBytes),
+                                   locale.formattedDataSize(spilledBytes)));
+    });
+
+    // Commands computing in the background, with a way to abandon them
+    QLabel *executionLabel = new QLabel(this);
+    QProgressBar *executionProgress = new QProgressBar(this);
+    executionProgress->setRange(0, 0);
+    executionProgress->setMaximumWidth(120);
+    QToolButton *cancelButton = new QToolButton(this);
+    cancelButton->setText(tr("Cancel"));
+    statusBar()->addPermanentWidget(executionLabel);
+    statusBar()->addPermanentWidget(executionProgress);
+    statusBar()->addPermanentWidget(cancelButton);
+    executionLabel->hide();
+    executionProgress->hide();
+    cancelButton->hide();
+
+    connect(cancelButton, &QToolButton::clicked, commandManager, &CommandManager::cancelPendingCommands);
+    connect(commandManager, &CommandManager::executionChanged, this,
+            [executionLabel, executionProgress, cancelButton](const QString &text, int pendingCount) {
+        const bool busy = pendingCount > 0;
+        if (pendingCount > 1)
+            executionLabel->setText(tr("Applying %1 (%2 more queued)...").arg(text).arg(pendingCount - 1));
+        else
+            executionLabel->setText(tr("Applying %1...").arg(text));
+        executionLabel->setVisible(busy);
+        executionProgress->setVisible(busy);
+        cancelButton->setVisible(busy);
+    });
 }
 
 void MainWindow::updateActions()
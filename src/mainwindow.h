@@ -5,7 +5,6 @@
 #include <QImage>
 #include <QString>
 #include <QList>
-#include <QFutureWatcher>
 
 class QAction;
 class QLabel;
@@ -44,6 +43,7 @@ public slots:
     void zoomOut();
     void normalSize();
     void fitToWindow();
+    void toggleColorLutPreview();
 
     // Auto-enhancement
     void autoEnhance();
@@ -66,6 +66,8 @@ public slots:
     void applySharpen();
     void applyBlur();
     void applyEdgeDetection();
+    void applyCustomKernel();
+    void applyColorLut();
     // Transformations
     void rotate90();
     void rotate180();
@@ -104,6 +106,9 @@ private slots:
     // Update view when image changes
     void updateImageDisplay();
 
+    // Undo, redo or a jump in the history view
+    void onHistoryNavigated();
+
 private:
     void createMenus();
     void createToolBars();
@@ -114,26 +119,23 @@ private:
     // Apply all current adjustments from properties panel to preview
     QImage applyCurrentAdjustments(const QImage &sourceImage);
 
-    // Get preview-sized version of image for faster processing
-    QImage getPreviewImage(const QImage &sourceImage);
+    // Show a frame rendered by PreviewManager
+    void onPreviewReady(const QImage &preview);
 
-    // Handle async preview completion
-    void onPreviewReady();
+    // Show the live preview or the best pyramid level for the display size
+    void refreshDisplayedImage();
 
     // AI enhancement
     void applyAIEnhancements(const QList<ImageEnhancementSuggestion>& suggestions);
 
     ImageDocument *document;   // Document managing images and file I/O
     QImage previewImage;       // Preview with temporary adjustments
-    QImage previewSourceImage; // Downscaled source for fast preview
     QLabel *imageLabel;
     QScrollArea *scrollArea;
     QWidget *placeholderWidget;  // Drag & drop hint when no image loaded
 
     // Async processing
-    QFutureWatcher<QImage> *previewWatcher;
     QProgressBar *progressBar;
-    bool isProcessing;
 
     CommandManager *commandManager;
     ViewManager *viewManager;
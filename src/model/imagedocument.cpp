@@ -4,11 +4,15 @@
 #include <QImageWriter>
 #include <QDir>
 #include <QFileInfo>
+#include <QtConcurrent/QtConcurrentRun>
 
 ImageDocument::ImageDocument(QObject *parent)
     : QObject(parent)
     , m_modified(false)
+    , m_pyramidWatcher(new QFutureWatcher<ImagePyramid>(this))
 {
+    connect(m_pyramidWatcher, &QFutureWatcher<ImagePyramid>::finished,
+            this, &ImageDocument::onPyramidBuilt);
 }
 
 bool ImageDocument::load(const QString &filePath)
@@ -54,6 +58,7 @@ bool ImageDocument::load(const QString &filePath)
     emit originalImageChanged(m_originalImage);
     emit filePathChanged(m_filePath);
     emit loaded(filePath);
+    updatePyramid();
 
     return true;
 }
@@ -133,6 +138,7 @@ void ImageDocument::setCurrentImage(const QImage &image)
     m_currentImage = image;
     setModified(true);
     emit imageChanged(m_currentImage);
+    updatePyramid();
 }
 
 void ImageDocument::setOriginalImage(const QImage &image)
@@ -150,6 +156,56 @@ QImage* ImageDocument::currentImagePtr()
     return &m_currentImage;
 }
 
+QImage ImageDocument::pyramidLevel(const QSize &minimumSize) const
+{
+    // Outdated levels are never served, the full image is always correct
+    if (m_pyramid.sourceKey() != m_currentImage.cacheKey())
+        return m_currentImage;
+
+    const QImage level = m_pyramid.levelFor(minimumSize);
+    return level.isNull() ? m_currentImage : level;
+}
+
+QImage ImageDocument::pyramidLevel(int minimumDimension) const
+{
+    if (m_pyramid.sourceKey() != m_currentImage.cacheKey())
+        return m_currentImage;
+
+    const QImage level = m_pyramid.levelFor(minimumDimension);
+    return level.isNull() ? m_currentImage : level;
+}
+
+void ImageDocument::updatePyramid()
+{
+    if (m_currentImage.isNull()) {
+        m_pyramid = ImagePyramid();
+        return;
+    }
+
+    // A running build is checked against the current image when it finishes
+    if (m_pyramid.sourceKey() == m_currentImage.cacheKey() || m_pyramidWatcher->isRunning())
+        return;
+
+    const QImage image = m_currentImage;
+    m_pyramidWatcher->setFuture(QtConcurrent::run([image]() {
+        return ImagePyramid(image);
+    }));
+}
+
+void ImageDocument::onPyramidBuilt()
+{
+    ImagePyramid pyramid = m_pyramidWatcher->result();
+    if (pyramid.sourceKey() != m_currentImage.cacheKey()) {
+        // The image changed during the build
+        updatePyramid();
+        return;
+    }
+
+    m_pyramid = pyramid;
+    LOG_DEBUG(QString("Image pyramid ready: %1 levels").arg(m_pyramid.levelCount()));
+    emit pyramidReady();
+}
+
 QString ImageDocument::filePath() const
 {
     return m_filePath;
@@ -185,6 +241,7 @@ void ImageDocument::clear()
     m_currentImage = QImage();
     m_originalImage = QImage();
     m_filePath.clear();
+    m_pyramid = ImagePyramid();
     setModified(false);
 
     emit imageChanged(m_currentImage);
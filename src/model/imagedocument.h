@@ -4,6 +4,8 @@
 #include <QObject>
 #include <QImage>
 #include <QString>
+#include <QFutureWatcher>
+#include "imagepyramid.h"
 
 /**
  * @class ImageDocument
@@ -13,6 +15,8 @@
  * - Loading and saving images from/to disk
  * - Managing the current and original image state
  * - Tracking document modifications
+ * - Keeping an ImagePyramid of the current image for previews, zoomed-out
+ *   display and analysis, rebuilt in the background after every change
  *
  * This class follows the Single Responsibility Principle by handling only
  * document-level concerns, separating file I/O and state management from the UI.
@@ -38,6 +42,16 @@ public:
     // Direct access for undo commands (returns pointer to internal image)
     QImage* currentImagePtr();
 
+    /**
+     * Smallest pyramid level of the current image covering minimumSize
+     * Falls back to the current image itself while the pyramid is being
+     * rebuilt, so callers never see a level of an older image.
+     */
+    QImage pyramidLevel(const QSize &minimumSize) const;
+
+    // Same, for a minimum length of the longest side
+    QImage pyramidLevel(int minimumDimension) const;
+
     // Properties
     QString filePath() const;
     bool isModified() const;
@@ -51,6 +65,10 @@ public:
     // Clear document
     void clear();
 
+public slots:
+    // Rebuild the pyramid in the background if the current image changed
+    void updatePyramid();
+
 signals:
     void imageChanged(const QImage &newImage);
     void originalImageChanged(const QImage &newImage);
@@ -60,11 +78,19 @@ signals:
     void saved(const QString &filePath);
     void errorOccurred(const QString &error);
 
+    // Emitted when pyramid levels of the current image become available
+    void pyramidReady();
+
+private slots:
+    void onPyramidBuilt();
+
 private:
     QImage m_currentImage;
     QImage m_originalImage;
     QString m_filePath;
     bool m_modified;
+    ImagePyramid m_pyramid;
+    QFutureWatcher<ImagePyramid> *m_pyramidWatcher;
 
     // Validation
     bool validateImage(const QImage &image) const;
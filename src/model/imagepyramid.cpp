@@ -0,0 +1,98 @@
+#include "imagepyramid.h"
+#include "../processing/imagebufferpool.h"
+#include "../processing/parallelrows.h"
+#include <algorithm>
+
+ImagePyramid::ImagePyramid()
+    : m_sourceKey(0)
+{
+}
+
+ImagePyramid::ImagePyramid(const QImage &image)
+    : m_sourceSize(image.size())
+    , m_sourceKey(image.isNull() ? 0 : image.cacheKey())
+{
+    if (image.isNull())
+        return;
+
+    QImage current = image;
+    while (std::max(current.width(), current.height()) / 2 >= MinLevelDimension) {
+        current = halve(current);
+        m_levels.append(current);
+    }
+}
+
+QImage ImagePyramid::levelFor(const QSize &minimumSize) const
+{
+    // Levels shrink, the last one that still covers the size wins
+    QImage best;
+    for (const QImage &level : m_levels) {
+        if (level.width() < minimumSize.width() || level.height() < minimumSize.height())
+            break;
+        best = level;
+    }
+    return best;
+}
+
+QImage ImagePyramid::levelFor(int minimumDimension) const
+{
+    QImage best;
+    for (const QImage &level : m_levels) {
+        if (std::max(level.width(), level.height()) < minimumDimension)
+            break;
+        best = level;
+    }
+    return best;
+}
+
+QImage ImagePyramid::halve(const QImage &image)
+{
+    if (image.isNull())
+        return image;
+
+    // Averaging premultiplied pixels is exact; straight ARGB32 is close
+    // enough for display and analysis and keeps the source format
+    QImage source = image;
+    if (source.format() != QImage::Format_RGB32 && source.format() != QImage::Format_ARGB32
+        && source.format() != QImage::Format_ARGB32_Premultiplied) {
+        source = source.convertToFormat(source.hasAlphaChannel() ? QImage::Format_ARGB32
+                                                                 : QImage::Format_RGB32);
+    }
+
+    const int width = source.width();
+    const int height = source.height();
+    const int halfWidth = std::max(1, (width + 1) / 2);
+    const int halfHeight = std::max(1, (height + 1) / 2);
+    QImage result = ImageBufferPool::acquire(QSize(halfWidth, halfHeight), source.format());
+    if (result.isNull())
+        return result;
+
+    // Detach once here, scanLine() on the target would detach from every band
+    uchar *targetBits = result.bits();
+    const qsizetype targetStride = result.bytesPerLine();
+    const QImage &input = source;
+    ParallelRows::forRanges(halfHeight, halfWidth * 4, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const QRgb *top = reinterpret_cast<const QRgb*>(input.constScanLine(2 * y));
+            const QRgb *bottom = reinterpret_cast<const QRgb*>(
+                input.constScanLine(std::min(2 * y + 1, height - 1)));
+            QRgb *target = reinterpret_cast<QRgb*>(targetBits + y * targetStride);
+
+            for (int x = 0; x < halfWidth; ++x) {
+                const int left = 2 * x;
+                const int right = std::min(left + 1, width - 1);
+                const QRgb p0 = top[left], p1 = top[right];
+                const QRgb p2 = bottom[left], p3 = bottom[right];
+
+                // Two channels per 32-bit lane pair, four sums of 8-bit values fit in 16 bits
+                const quint32 rb = (p0 & 0x00FF00FF) + (p1 & 0x00FF00FF)
+                                 + (p2 & 0x00FF00FF) + (p3 & 0x00FF00FF) + 0x00020002;
+                const quint32 ag = ((p0 >> 8) & 0x00FF00FF) + ((p1 >> 8) & 0x00FF00FF)
+                                 + ((p2 >> 8) & 0x00FF00FF) + ((p3 >> 8) & 0x00FF00FF) + 0x00020002;
+                target[x] = ((rb >> 2) & 0x00FF00FF) | (((ag >> 2) & 0x00FF00FF) << 8);
+            }
+        }
+    });
+
+    return result;
+}
@@ -0,0 +1,56 @@
+#ifndef IMAGEPYRAMID_H
+#define IMAGEPYRAMID_H
+
+#include <QImage>
+#include <QSize>
+#include <QVector>
+
+/**
+ * @class ImagePyramid
+ * @brief Reduced copies of an image at 1/2, 1/4, 1/8... of its size
+ *
+ * Each level is a 2x2 box average of the previous one, so building the
+ * whole pyramid costs about a third of one pass over the image. Levels
+ * stop once the longest side would drop below MinLevelDimension.
+ *
+ * The pyramid does not keep the full-size image: sharing its pixels
+ * would force a deep copy the next time a command edits the document.
+ * levelFor() returns a null image when only the full size is big enough.
+ * sourceKey() records the QImage::cacheKey() the levels were built from,
+ * so the owner can tell when they are outdated.
+ */
+class ImagePyramid
+{
+public:
+    static constexpr int MinLevelDimension = 256;
+
+    // Null pyramid
+    ImagePyramid();
+
+    // Build all levels of image (heavy for large images, meant for a worker thread)
+    explicit ImagePyramid(const QImage &image);
+
+    bool isNull() const { return m_sourceKey == 0; }
+    qint64 sourceKey() const { return m_sourceKey; }
+    QSize sourceSize() const { return m_sourceSize; }
+
+    // Levels below the full size, level(0) is half size
+    int levelCount() const { return m_levels.size(); }
+    QImage level(int index) const { return m_levels.at(index); }
+
+    // Smallest level at least minimumSize in both dimensions, null if none
+    QImage levelFor(const QSize &minimumSize) const;
+
+    // Smallest level whose longest side is at least minimumDimension, null if none
+    QImage levelFor(int minimumDimension) const;
+
+    // 2x2 box average, odd sizes repeat the last row/column
+    static QImage halve(const QImage &image);
+
+private:
+    QVector<QImage> m_levels;
+    QSize m_sourceSize;
+    qint64 m_sourceKey;
+};
+
+#endif // IMAGEPYRAMID_H
@@ -0,0 +1,124 @@
+#ifndef BUDGETEDIMAGECACHE_H
+#define BUDGETEDIMAGECACHE_H
+
+#include <QImage>
+#include <QVector>
+
+/**
+ * @class BudgetedImageCache
+ * @brief Memory-budgeted LRU store of images, the bookkeeping shared by
+ *        the preview caches
+ *
+ * Entries pair a Key with an image. The caches differ only in how a key
+ * matches a request, so lookups take that test as a callable; the byte
+ * count, use counter and eviction live here. Once the images exceed the
+ * budget, the least recently used entries go first.
+ */
+template <typename Key>
+class BudgetedImageCache
+{
+public:
+    explicit BudgetedImageCache(qint64 budgetBytes)
+        : m_budget(budgetBytes)
+        , m_bytes(0)
+        , m_useCounter(0)
+    {
+    }
+
+    /**
+     * Image of the entry whose key scores highest, ties going to the oldest
+     * @param score Callable (const Key &) -> int, negative for keys that do not match
+     * @param key Receives the key of that entry, nullptr on a miss
+     * @return Null image on a miss
+     */
+    template <typename Score>
+    QImage find(Score score, const Key **key = nullptr)
+    {
+        int best = -1;
+        int bestScore = -1;
+        for (int i = 0; i < m_entries.size(); ++i) {
+            const int entryScore = score(m_entries.at(i).key);
+            if (entryScore > bestScore) {
+                best = i;
+                bestScore = entryScore;
+            }
+        }
+
+        if (key)
+            *key = best >= 0 ? &m_entries.at(best).key : nullptr;
+        if (best < 0)
+            return QImage();
+
+        Entry &entry = m_entries[best];
+        entry.lastUse = ++m_useCounter;
+        return entry.image;
+    }
+
+    /**
+     * Store an image, replacing the first entry whose key matches; images
+     * over the budget are not kept
+     * @param matches Callable (const Key &) -> bool
+     */
+    template <typename Match>
+    void insert(const Key &key, const QImage &image, Match matches)
+    {
+        const qint64 size = image.sizeInBytes();
+        if (image.isNull() || size > m_budget)
+            return;
+
+        for (int i = 0; i < m_entries.size(); ++i) {
+            if (matches(m_entries.at(i).key)) {
+                m_bytes -= m_entries.at(i).image.sizeInBytes();
+                m_entries.remove(i);
+                break;
+            }
+        }
+
+        m_entries.append({key, image, ++m_useCounter});
+        m_bytes += size;
+        evict();
+    }
+
+    void clear()
+    {
+        m_entries.clear();
+        m_bytes = 0;
+    }
+
+    qint64 budget() const { return m_budget; }
+    qint64 bytes() const { return m_bytes; }
+
+    void setBudget(qint64 budgetBytes)
+    {
+        m_budget = budgetBytes;
+        evict();
+    }
+
+private:
+    struct Entry
+    {
+        Key key;
+        QImage image;
+        quint64 lastUse;
+    };
+
+    void evict()
+    {
+        while (m_bytes > m_budget && !m_entries.isEmpty()) {
+            int oldest = 0;
+            for (int i = 1; i < m_entries.size(); ++i) {
+                if (m_entries.at(i).lastUse < m_entries.at(oldest).lastUse)
+                    oldest = i;
+            }
+            m_bytes -= m_entries.at(oldest).image.sizeInBytes();
+            m_entries.remove(oldest);
+        }
+    }
+
+    QVector<Entry> m_entries;
+    qint64 m_budget;
+    qint64 m_bytes;
+    quint64 m_useCounter;
+};
+
+#endif // BUDGETEDIMAGECACHE_H
@@ -0,0 +1,37 @@
+#include "previewframecache.h"
+#include "../processing/adjustmentkernel.h"
+#include <QHashFunctions>
+
+PreviewFrameCache::PreviewFrameCache(qint64 budgetBytes)
+    : m_cache(budgetBytes)
+{
+}
+
+size_t PreviewFrameCache::hashParameters(const AdjustmentParameters &params)
+{
+    return qHashMulti(0, params.brightness, params.contrast, params.saturation, params.hue,
+                      params.gamma, params.temperature, params.exposure,
+                      params.shadows, params.highlights);
+}
+
+bool PreviewFrameCache::Key::matches(const Key &other) const
+{
+    // operator== tolerates gamma differences, a frame must match exactly
+    return hash == other.hash && sourceKey == other.sourceKey && size == other.size
+        && lutSize == other.lutSize
+        && AdjustmentKernel::firstChangedStage(params, other.params) == AdjustmentKernel::StageCount;
+}
+
+QImage PreviewFrameCache::find(qint64 sourceKey, const QSize &size, int lutSize,
+                               const AdjustmentParameters &params)
+{
+    const Key wanted{sourceKey, size, lutSize, hashParameters(params), params};
+    return m_cache.find([&](const Key &key) { return key.matches(wanted) ? 0 : -1; });
+}
+
+void PreviewFrameCache::insert(qint64 sourceKey, const QSize &size, int lutSize,
+                               const AdjustmentParameters &params, const QImage &frame)
+{
+    const Key key{sourceKey, size, lutSize, hashParameters(params), params};
+    m_cache.insert(key, frame, [&](const Key &other) { return other.matches(key); });
+}
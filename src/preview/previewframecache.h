@@ -0,0 +1,58 @@
+#ifndef PREVIEWFRAMECACHE_H
+#define PREVIEWFRAMECACHE_H
+
+#include <QImage>
+#include <QSize>
+#include "../model/adjustmentparameters.h"
+#include "budgetedimagecache.h"
+
+/**
+ * @class PreviewFrameCache
+ * @brief Memory-budgeted LRU cache of finished preview frames
+ *
+ * Frames are keyed by the preview source (QImage::cacheKey() of the
+ * pyramid level), the frame size, the 3D LUT preview size (0 for the exact
+ * kernel) and the adjustment parameters. Parameters are compared exactly,
+ * through a hash first, so a frame is only reused for the very same
+ * slider values. Scrubbing back to a value or toggling between settings
+ * then shows the frame without rendering it again.
+ */
+class PreviewFrameCache
+{
+public:
+    static constexpr qint64 DefaultBudget = 128LL * 1024 * 1024;
+
+    explicit PreviewFrameCache(qint64 budgetBytes = DefaultBudget);
+
+    // Null image on a miss
+    QImage find(qint64 sourceKey, const QSize &size, int lutSize,
+                const AdjustmentParameters &params);
+
+    // Frames over the budget are not kept
+    void insert(qint64 sourceKey, const QSize &size, int lutSize,
+                const AdjustmentParameters &params, const QImage &frame);
+
+    void clear() { m_cache.clear(); }
+
+    qint64 budget() const { return m_cache.budget(); }
+    void setBudget(qint64 budgetBytes) { m_cache.setBudget(budgetBytes); }
+    qint64 bytes() const { return m_cache.bytes(); }
+
+    static size_t hashParameters(const AdjustmentParameters &params);
+
+private:
+    struct Key
+    {
+        qint64 sourceKey;
+        QSize size;
+        int lutSize;
+        size_t hash;
+        AdjustmentParameters params;
+
+        bool matches(const Key &other) const;
+    };
+
+    BudgetedImageCache<Key> m_cache;
+};
+
+#endif // PREVIEWFRAMECACHE_H
@@ -1,11 +1,123 @@
 #include "previewmanager.h"
 #include "../imageprocessor.h"
+#include "../processing/adjustmentkernel.h"
+#include "../processing/imagebufferpool.h"
+#include "../logging/logger.h"
+#include "../processing/pixelkernels.h"
+#include <QTimer>
+#include <QtConcurrent/QtConcurrentRun>
+
+static bool proxyIsSource(const QImage &source, const QSize &targetSize)
+{
+    return !targetSize.isValid()
+        || (targetSize.width() >= source.width() && targetSize.height() >= source.height());
+}
+
+// Source scaled to the display size, or the source itself when that is not smaller
+static QImage previewProxy(const QImage &source, const QSize &targetSize)
+{
+    if (proxyIsSource(source, targetSize))
+        return source;
+
+    return source.scaled(targetSize.boundedTo(source.size()),
+                         Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+}
+
+// Kernel stages a frame can skip and the prefix it should leave behind
+struct StagePlan
+{
+    QImage prefix;        // Output of stages [0, firstStage), null to start from the proxy
+    int firstStage = 0;
+    int storeStage = AdjustmentKernel::StageCount;  // Keep the output of [0, storeStage)
+};
+
+// Run kernel stages on a copy; rows left after a cancel are skipped, so a stale frame stops early
+static QImage runStages(const QImage &input, const AdjustmentKernel &kernel, int firstStage,
+                        int endStage, const std::atomic<bool> &cancelled)
+{
+    return PixelKernels::mapRows(input, [&](QRgb *line, int, int width) {
+        if (!cancelled.load(std::memory_order_relaxed))
+            kernel.processRow(line, width, firstStage, endStage);
+    });
+}
+
+// Worker side of requestPreview(), the frame image is null when cancelled
+template <typename Frame>
+static Frame renderPreview(const QImage &source, const QImage &cachedProxy, const QSize &targetSize,
+                           const AdjustmentKernel &kernel, const ColorLut3D &lut,
+                           const StagePlan &plan, const std::atomic<bool> &cancelled)
+{
+    Frame frame;
+    frame.proxy = cachedProxy.isNull() ? previewProxy(source, targetSize) : cachedProxy;
+    if (lut.isNull() && kernel.isIdentity()) {
+        frame.image = frame.proxy;
+        return frame;
+    }
+    if (cancelled.load(std::memory_order_relaxed))
+        return frame;
+
+    if (!lut.isNull()) {
+        QImage adjusted = PixelKernels::mapRows(frame.proxy, [&](QRgb *line, int, int width) {
+            if (cancelled.load(std::memory_order_relaxed))
+                return;
+            for (int x = 0; x < width; ++x)
+                line[x] = lut.map(line[x]);
+        });
+        if (!cancelled.load(std::memory_order_relaxed))
+            frame.image = adjusted;
+        return frame;
+    }
+
+    QImage input = plan.prefix.isNull() ? frame.proxy : plan.prefix;
+    int firstStage = plan.prefix.isNull() ? 0 : plan.firstStage;
+
+    // Stop once in front of the stage being edited and keep that image;
+    // only for 32-bit sources, others would round-trip through their format
+    if (plan.storeStage > firstStage && plan.storeStage < AdjustmentKernel::StageCount
+        && kernel.hasStages(firstStage, plan.storeStage)
+        && input.format() == PixelKernels::workingFormat(input)) {
+        input = runStages(input, kernel, firstStage, plan.storeStage, cancelled);
+        if (cancelled.load(std::memory_order_relaxed))
+            return frame;
+        frame.prefix = input;
+        frame.prefixStage = plan.storeStage;
+        firstStage = plan.storeStage;
+    }
+
+    QImage adjusted = runStages(input, kernel, firstStage, AdjustmentKernel::StageCount, cancelled);
+    if (!cancelled.load(std::memory_order_relaxed))
+        frame.image = adjusted;
+
+    return frame;
+}
 
 PreviewManager::PreviewManager(ImageProcessor *processor, QObject *parent)
     : QObject(parent)
     , m_processor(processor)
     , m_isProcessing(false)
+    , m_colorLutPreview(false)
+    , m_colorLutSize(ColorLut3D::DefaultSize)
+    , m_watcher(new QFutureWatcher<PreviewFrame>(this))
+    , m_renderingSourceKey(0)
+    , m_renderingPass(FinalPass)
+    , m_renderingLutSize(0)
+    , m_hasPendingRequest(false)
+    , m_pendingPass(FinalPass)
+    , m_refineTimer(new QTimer(this))
+    , m_editedStage(AdjustmentKernel::StageCount)
 {
+    connect(m_watcher, &QFutureWatcher<PreviewFrame>::finished, this, &PreviewManager::onRenderFinished);
+    m_refineTimer->setSingleShot(true);
+    m_refineTimer->setInterval(RefineDelay);
+    connect(m_refineTimer, &QTimer::timeout, this, &PreviewManager::onRefineTimeout);
+    m_sinceLastFrame.start();
+}
+
+PreviewManager::~PreviewManager()
+{
+    // The worker reads the cancel flag and the captured images, let it stop first
+    cancelPreview();
+    m_watcher->waitForFinished();
 }
 
 QImage PreviewManager::generatePreview(const QImage &source, const AdjustmentParameters &params)
@@ -16,14 +128,85 @@ QImage PreviewManager::generatePreview(const QImage &source, const AdjustmentPar
     return applyAdjustments(source, params);
 }
 
-QImage PreviewManager::getOptimizedPreviewSource(const QImage &source, int maxDimension)
+void PreviewManager::requestPreview(const QImage &source, const AdjustmentParameters &params,
+                                    const QSize &targetSize)
 {
-    if (source.width() <= maxDimension && source.height() <= maxDimension)
-        return source; // Already small enough
+    if (source.isNull())
+        return;
+
+    m_requestSource = source;
+    m_requestParams = params;
+    m_requestSize = targetSize;
+    m_hasPendingRequest = true;
+    m_pendingPass = passSize(CoarsePass).isValid() ? CoarsePass : FinalPass;
 
-    // Downscale for preview
-    return source.scaled(maxDimension, maxDimension,
-                        Qt::KeepAspectRatio, Qt::FastTransformation);
+    // Settings seen before come from the frame cache: a final frame ends
+    // the request, a coarse one is shown while the refinement is pending
+    const int lutSize = m_colorLutPreview ? m_colorLutSize : 0;
+    const QImage finalFrame = m_frameCache.find(source.cacheKey(), passSize(FinalPass), lutSize, params);
+    if (!finalFrame.isNull()) {
+        showCachedFrame(finalFrame, params);
+        m_requestSource = QImage();
+        m_refineTimer->stop();
+        return;
+    }
+
+    // Refine once the input has been idle for RefineDelay
+    if (m_pendingPass != CoarsePass) {
+        m_refineTimer->stop();
+    } else {
+        m_refineTimer->start();
+        const QImage coarseFrame = m_frameCache.find(source.cacheKey(), passSize(CoarsePass), lutSize, params);
+        if (!coarseFrame.isNull()) {
+            showCachedFrame(coarseFrame, params);
+            return;
+        }
+    }
+
+    if (!m_watcher->isRunning()) {
+        startRender();
+        return;
+    }
+
+    // Superseded: stop the frame in flight unless the display has waited too
+    // long; a refinement is always stopped, a coarse frame follows quickly
+    if (m_renderingPass == FinalPass && m_pendingPass == CoarsePass)
+        m_cancelled->store(true, std::memory_order_relaxed);
+    else if (m_sinceLastFrame.elapsed() < MinFrameInterval)
+        m_cancelled->store(true, std::memory_order_relaxed);
+}
+
+void PreviewManager::showCachedFrame(const QImage &frame, const AdjustmentParameters &params)
+{
+    // The frame in flight is older than this one
+    m_hasPendingRequest = false;
+    if (m_cancelled)
+        m_cancelled->store(true, std::memory_order_relaxed);
+
+    m_sinceLastFrame.restart();
+    emit previewReady(frame, params);
+}
+
+void PreviewManager::clearCache()
+{
+    m_frameCache.clear();
+    m_stageCache.clear();
+    for (ProxyCache &proxy : m_proxies)
+        proxy = ProxyCache();
+
+    const ImageBufferPool::Stats pool = ImageBufferPool::stats();
+    LOG_DEBUG(QString("Image buffer pool: %1 MB in use, %2 MB idle, peak %3 MB, %4 allocations, %5 reuses")
+              .arg(pool.inUseBytes / (1024 * 1024)).arg(pool.idleBytes / (1024 * 1024))
+              .arg(pool.highWaterBytes / (1024 * 1024)).arg(pool.allocations).arg(pool.reuses));
+}
+
+void PreviewManager::cancelPreview()
+{
+    m_hasPendingRequest = false;
+    m_requestSource = QImage();
+    m_refineTimer->stop();
+    if (m_cancelled)
+        m_cancelled->store(true, std::memory_order_relaxed);
 }
 
 void PreviewManager::setProcessing(bool processing)
@@ -34,37 +217,141 @@ void PreviewManager::setProcessing(bool processing)
     }
 }
 
-QImage PreviewManager::applyAdjustments(const QImage &source, const AdjustmentParameters &params)
+void PreviewManager::setColorLutPreview(bool enabled, int lutSize)
 {
-    QImage result = source;
+    m_colorLutPreview = enabled;
+    if (m_colorLutSize != lutSize) {
+        m_colorLutSize = lutSize;
+        m_bakedLut = ColorLut3D();
+    }
+}
 
-    // Apply adjustments in sequence
-    if (params.brightness != 0)
-        result = m_processor->adjustBrightness(result, params.brightness);
+void PreviewManager::onRenderFinished()
+{
+    const PreviewFrame frame = m_watcher->result();
+    const bool cancelled = m_cancelled->load(std::memory_order_relaxed);
 
-    if (params.contrast != 0)
-        result = m_processor->adjustContrast(result, params.contrast);
+    // The proxy stays valid even when the frame was cancelled. A proxy that
+    // is the source itself is not kept: holding a reference to the document
+    // image would make the next command deep-copy it.
+    ProxyCache &proxy = m_proxies[m_renderingPass];
+    proxy.image = frame.proxy.cacheKey() == m_renderingSourceKey ? QImage() : frame.proxy;
+    proxy.sourceKey = m_renderingSourceKey;
+    proxy.size = m_renderingSize;
 
-    if (params.saturation != 0)
-        result = m_processor->adjustSaturation(result, params.saturation);
+    if (!frame.prefix.isNull() && !cancelled)
+        m_stageCache.insert(frame.proxy.cacheKey(), m_renderingParams, frame.prefixStage, frame.prefix);
 
-    if (params.hue != 0)
-        result = m_processor->adjustHue(result, params.hue);
+    if (!cancelled && !frame.image.isNull()) {
+        // Frames sharing the source image are not kept, see the proxy above
+        if (frame.image.cacheKey() != m_renderingSourceKey) {
+            m_frameCache.insert(m_renderingSourceKey, m_renderingSize, m_renderingLutSize,
+                                m_renderingParams, frame.image);
+        }
+        m_sinceLastFrame.restart();
+        emit previewReady(frame.image, m_renderingParams);
+    }
 
-    if (qAbs(params.gamma - 1.0) > 0.01)
-        result = m_processor->adjustGamma(result, params.gamma);
+    if (m_hasPendingRequest) {
+        startRender();
+        return;
+    }
 
-    if (params.temperature != 0)
-        result = m_processor->adjustColorTemperature(result, params.temperature);
+    setProcessing(false);
+    if (m_renderingPass == FinalPass && !m_refineTimer->isActive())
+        m_requestSource = QImage();  // Refined, nothing left to render
+}
 
-    if (params.exposure != 0)
-        result = m_processor->adjustExposure(result, params.exposure);
+void PreviewManager::onRefineTimeout()
+{
+    if (m_requestSource.isNull())
+        return;
+
+    m_pendingPass = FinalPass;
+    m_hasPendingRequest = true;
 
-    if (params.shadows != 0)
-        result = m_processor->adjustShadows(result, params.shadows);
+    // A coarse frame still running is shown first, the refinement follows
+    if (!m_watcher->isRunning())
+        startRender();
+}
 
-    if (params.highlights != 0)
-        result = m_processor->adjustHighlights(result, params.highlights);
+QSize PreviewManager::passSize(Pass pass) const
+{
+    const QSize display = m_requestSize.isValid() ? m_requestSize : m_requestSource.size();
+    if (pass == FinalPass)
+        return display;
+
+    // No coarse pass when the full frame is cheap already
+    if (qint64(display.width()) * display.height() <= CoarseMinPixels)
+        return QSize();
+
+    return (display / CoarseDivisor).expandedTo(QSize(1, 1));
+}
+
+void PreviewManager::startRender()
+{
+    const QImage source = m_requestSource;
+    const QSize targetSize = passSize(m_pendingPass);
+    m_renderingPass = m_pendingPass;
+    m_renderingParams = m_requestParams;
+    m_renderingSourceKey = source.cacheKey();
+    m_renderingSize = targetSize;
+    m_renderingLutSize = m_colorLutPreview ? m_colorLutSize : 0;
+    m_hasPendingRequest = false;
+
+    // Reuse the proxy while neither the source nor the pass size changed
+    const ProxyCache &cached = m_proxies[m_renderingPass];
+    const QImage proxy = (cached.sourceKey == m_renderingSourceKey && cached.size == targetSize)
+                         ? cached.image : QImage();
+
+    // Tables are compiled (or the LUT baked) here so the worker owns no shared state
+    ColorLut3D lut;
+    if (m_colorLutPreview && m_renderingParams.hasAnyAdjustments()) {
+        if (m_bakedLut.isNull() || m_bakedParams != m_renderingParams) {
+            m_bakedLut = m_processor->bakeAdjustments(m_renderingParams, m_colorLutSize);
+            m_bakedParams = m_renderingParams;
+        }
+        lut = m_bakedLut;
+    }
+    const AdjustmentKernel kernel(m_lutCompiler.compile(m_renderingParams));
+
+    // Start from the longest cached prefix of the chain, and leave one
+    // behind in front of the stage being edited (the first stage that
+    // changed between the last two distinct requests)
+    StagePlan plan;
+    if (lut.isNull() && !kernel.isIdentity()) {
+        const int changedStage = AdjustmentKernel::firstChangedStage(m_lastStageParams, m_renderingParams);
+        if (changedStage < AdjustmentKernel::StageCount)
+            m_editedStage = changedStage;
+        m_lastStageParams = m_renderingParams;
+
+        const qint64 proxyKey = !proxy.isNull() ? proxy.cacheKey()
+                              : proxyIsSource(source, targetSize) ? source.cacheKey() : 0;
+        if (proxyKey != 0)
+            plan.prefix = m_stageCache.find(proxyKey, m_renderingParams, &plan.firstStage);
+        plan.storeStage = m_editedStage;
+    }
+
+    m_cancelled = std::make_shared<std::atomic<bool>>(false);
+    std::shared_ptr<std::atomic<bool>> cancelled = m_cancelled;
+
+    setProcessing(true);
+    m_watcher->setFuture(QtConcurrent::run([source, proxy, targetSize, kernel, lut, plan, cancelled]() {
+        return renderPreview<PreviewFrame>(source, proxy, targetSize, kernel, lut, plan, *cancelled);
+    }));
+}
+
+QImage PreviewManager::applyAdjustments(const QImage &source, const AdjustmentParameters &params)
+{
+    if (m_colorLutPreview && params.hasAnyAdjustments()) {
+        // Re-bake only when the sliders moved, the table is reused otherwise
+        if (m_bakedLut.isNull() || m_bakedParams != params) {
+            m_bakedLut = m_processor->bakeAdjustments(params, m_colorLutSize);
+            m_bakedParams = params;
+        }
+        return m_bakedLut.apply(source);
+    }
 
-    return result;
+    // ImageProcessor folds the per-channel stages into cached lookup tables
+    return m_processor->applyAdjustments(source, params);
 }
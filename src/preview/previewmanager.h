@@ -3,33 +3,164 @@
 
 #include <QObject>
 #include <QImage>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QSize>
+#include <atomic>
+#include <memory>
 #include "../model/adjustmentparameters.h"
+#include "../processing/adjustmentlut.h"
+#include "../processing/colorlut3d.h"
+#include "previewframecache.h"
+#include "previewstagecache.h"
 
 class ImageProcessor;
+class QTimer;
 
+/**
+ * @class PreviewManager
+ * @brief Renders live adjustment previews off the GUI thread
+ *
+ * requestPreview() never blocks: the frame is rendered on a worker thread
+ * and delivered through previewReady(). Frames are rendered at the size
+ * the image occupies on screen (ViewManager::previewSize()), from a
+ * proxy of the source that is downscaled once and cached until the
+ * source or the display size changes; full resolution is only processed
+ * at 100% zoom and above. Only one frame is in flight at a
+ * time and only the newest request waits behind it, so intermediate
+ * slider positions are dropped instead of queued. A frame that becomes
+ * stale is cancelled between scanlines, unless no frame has been shown
+ * for MinFrameInterval; then it is allowed to finish so that a continuous
+ * slider drag still updates the display.
+ *
+ * Large frames are refined progressively: while input keeps coming each
+ * request is rendered at 1/CoarseDivisor of the display size, which takes
+ * a few milliseconds, and once no request arrived for RefineDelay the
+ * same parameters are rendered again at full display resolution. New
+ * input always cancels a refinement in flight.
+ *
+ * While one slider is dragged, the output of the stages in front of it is
+ * kept in a PreviewStageCache, so later frames only run the stages from
+ * the edited one on. Finished frames go to a PreviewFrameCache, so
+ * returning to slider values seen before shows the frame right away;
+ * clearCache() drops both caches when the document image changes.
+ */
 class PreviewManager : public QObject
 {
     Q_OBJECT
 
 public:
+    // Longest time a drag goes without a finished frame, in milliseconds
+    static constexpr int MinFrameInterval = 33;
+
+    // Idle time before a coarse frame is refined, in milliseconds
+    static constexpr int RefineDelay = 150;
+
+    // Coarse frames are this many times smaller per side than the display...
+    static constexpr int CoarseDivisor = 4;
+
+    // ...for displays of more pixels than this, smaller ones render directly
+    static constexpr int CoarseMinPixels = 1024 * 1024;
+
     explicit PreviewManager(ImageProcessor *processor, QObject *parent = nullptr);
+    ~PreviewManager() override;
 
-    // Generate preview with optimized source
+    // Generate preview with optimized source (synchronous)
     QImage generatePreview(const QImage &source, const AdjustmentParameters &params);
 
-    // Get optimized preview source (downscaled for performance)
-    QImage getOptimizedPreviewSource(const QImage &source, int maxDimension = 1920);
+    /**
+     * Render asynchronously, the result arrives through previewReady()
+     * @param targetSize Size of the frame, at most the source size
+     *        (invalid: full resolution)
+     */
+    void requestPreview(const QImage &source, const AdjustmentParameters &params,
+                        const QSize &targetSize = QSize());
+
+    // Drop the pending request and cancel the frame in flight
+    void cancelPreview();
 
     bool isProcessing() const { return m_isProcessing; }
     void setProcessing(bool processing);
 
+    // Render previews through a baked 3D LUT (fixed cost per pixel, approximate)
+    void setColorLutPreview(bool enabled, int lutSize = ColorLut3D::DefaultSize);
+    bool isColorLutPreview() const { return m_colorLutPreview; }
+
+public slots:
+    // Drop cached frames and proxies, call when the document image changed
+    void clearCache();
+
 signals:
     void processingStateChanged(bool isProcessing);
+    void previewReady(const QImage &preview, const AdjustmentParameters &params);
+
+private slots:
+    void onRenderFinished();
+    void onRefineTimeout();
 
 private:
+    enum Pass {
+        CoarsePass,
+        FinalPass,
+        PassCount
+    };
+
+    void startRender();
+    void showCachedFrame(const QImage &frame, const AdjustmentParameters &params);
+    QSize passSize(Pass pass) const;
+
     ImageProcessor *m_processor;
     bool m_isProcessing;
 
+    // 3D LUT preview mode
+    bool m_colorLutPreview;
+    int m_colorLutSize;
+    ColorLut3D m_bakedLut;
+    AdjustmentParameters m_bakedParams;
+
+    // Asynchronous rendering
+    AdjustmentLutCompiler m_lutCompiler;
+    struct PreviewFrame
+    {
+        QImage image;  // Null when cancelled
+        QImage proxy;  // Downscaled source the frame was rendered from
+        QImage prefix; // Output of the stages in front of prefixStage, if kept
+        int prefixStage = 0;
+    };
+
+    struct ProxyCache
+    {
+        QImage image;
+        qint64 sourceKey = 0;
+        QSize size;
+    };
+
+    QFutureWatcher<PreviewFrame> *m_watcher;
+    std::shared_ptr<std::atomic<bool>> m_cancelled;  // Frame in flight
+    AdjustmentParameters m_renderingParams;
+    qint64 m_renderingSourceKey;
+    QSize m_renderingSize;
+    Pass m_renderingPass;
+    int m_renderingLutSize;  // 0 for the exact kernel
+
+    // Latest request, kept until it has been refined
+    QImage m_requestSource;
+    AdjustmentParameters m_requestParams;
+    QSize m_requestSize;
+    bool m_hasPendingRequest;
+    Pass m_pendingPass;
+    QTimer *m_refineTimer;
+
+    // Scaled source per pass
+    ProxyCache m_proxies[PassCount];
+
+    // Finished frames and partially adjusted proxies
+    PreviewFrameCache m_frameCache;
+    PreviewStageCache m_stageCache;
+    AdjustmentParameters m_lastStageParams;
+    int m_editedStage;
+    QElapsedTimer m_sinceLastFrame;
+
     QImage applyAdjustments(const QImage &source, const AdjustmentParameters &params);
 };
 
@@ -0,0 +1,31 @@
+#include "previewstagecache.h"
+#include "../processing/adjustmentkernel.h"
+
+PreviewStageCache::PreviewStageCache(qint64 budgetBytes)
+    : m_cache(budgetBytes)
+{
+}
+
+QImage PreviewStageCache::find(qint64 sourceKey, const AdjustmentParameters &params, int *stage)
+{
+    // The longest prefix whose stages ran with the same parameters
+    const Key *found = nullptr;
+    const QImage image = m_cache.find([&](const Key &key) {
+        const bool usable = key.sourceKey == sourceKey
+            && AdjustmentKernel::firstChangedStage(key.params, params) >= key.stage;
+        return usable ? key.stage : -1;
+    }, &found);
+
+    *stage = found ? found->stage : 0;
+    return image;
+}
+
+void PreviewStageCache::insert(qint64 sourceKey, const AdjustmentParameters &params, int stage,
+                               const QImage &image)
+{
+    // An entry for the same prefix is replaced rather than duplicated
+    m_cache.insert({sourceKey, params, stage}, image, [&](const Key &key) {
+        return key.sourceKey == sourceKey && key.stage == stage
+            && AdjustmentKernel::firstChangedStage(key.params, params) >= stage;
+    });
+}
@@ -0,0 +1,54 @@
+#ifndef PREVIEWSTAGECACHE_H
+#define PREVIEWSTAGECACHE_H
+
+#include <QImage>
+#include "../model/adjustmentparameters.h"
+#include "budgetedimagecache.h"
+
+/**
+ * @class PreviewStageCache
+ * @brief Memory-budgeted LRU cache of partially adjusted preview sources
+ *
+ * An entry is a preview source after the AdjustmentKernel stages
+ * [0, stage) ran with some parameters. It stands in for those stages for
+ * any parameters whose first changed stage (AdjustmentKernel::
+ * firstChangedStage()) is not before `stage`, so moving a late slider
+ * only reruns the tail of the chain. Sources are identified by
+ * QImage::cacheKey(); entries of replaced sources age out through the
+ * LRU order.
+ */
+class PreviewStageCache
+{
+public:
+    static constexpr qint64 DefaultBudget = 256LL * 1024 * 1024;
+
+    explicit PreviewStageCache(qint64 budgetBytes = DefaultBudget);
+
+    /**
+     * Longest cached prefix of the chain for these parameters
+     * @param stage Receives the first stage still to run (0 when none is cached)
+     * @return Null image when nothing usable is cached
+     */
+    QImage find(qint64 sourceKey, const AdjustmentParameters &params, int *stage);
+
+    // Store the output of stages [0, stage), images over the budget are not kept
+    void insert(qint64 sourceKey, const AdjustmentParameters &params, int stage, const QImage &image);
+
+    void clear() { m_cache.clear(); }
+
+    qint64 budget() const { return m_cache.budget(); }
+    void setBudget(qint64 budgetBytes) { m_cache.setBudget(budgetBytes); }
+    qint64 bytes() const { return m_cache.bytes(); }
+
+private:
+    struct Key
+    {
+        qint64 sourceKey;
+        AdjustmentParameters params;
+        int stage;
+    };
+
+    BudgetedImageCache<Key> m_cache;
+};
+
+#endif // PREVIEWSTAGECACHE_H
@@ -0,0 +1,119 @@
+#include "adjustmentkernel.h"
+
+AdjustmentKernel::AdjustmentKernel(const CompiledAdjustments &compiled)
+    : m_leadingLut(compiled.leadingLut)
+    , m_trailingLut(compiled.trailingLut)
+    , m_hasLeadingLut(!compiled.leadingLut.isIdentity())
+    , m_hasTrailingLut(!compiled.trailingLut.isIdentity())
+    , m_hasSaturation(compiled.saturation != 0)
+    , m_hasHue(compiled.hue != 0)
+    , m_hasShadows(compiled.shadows != 0)
+    , m_hasHighlights(compiled.highlights != 0)
+    , m_saturationFactor(saturationFactor(compiled.saturation))
+    , m_hueOffset(hueOffset(compiled.hue))
+    , m_shadowsFactor(toneFactor(compiled.shadows))
+    , m_highlightsFactor(toneFactor(compiled.highlights))
+{
+}
+
+bool AdjustmentKernel::isIdentity() const
+{
+    return !m_hasLeadingLut && !m_hasTrailingLut && !m_hasSaturation
+        && !m_hasHue && !m_hasShadows && !m_hasHighlights;
+}
+
+bool AdjustmentKernel::hasStages(int firstStage, int endStage) const
+{
+    const bool active[StageCount] = {
+        m_hasLeadingLut, m_hasSaturation, m_hasHue,
+        m_hasTrailingLut, m_hasShadows, m_hasHighlights
+    };
+    for (int stage = qMax(0, firstStage); stage < qMin(endStage, int(StageCount)); ++stage) {
+        if (active[stage])
+            return true;
+    }
+    return false;
+}
+
+int AdjustmentKernel::firstChangedStage(const AdjustmentParameters &a, const AdjustmentParameters &b)
+{
+    // Exact comparisons: parameters that compare equal may still build different tables
+    const bool hsvA = a.saturation != 0 || a.hue != 0;
+    const bool hsvB = b.saturation != 0 || b.hue != 0;
+    const bool pointStagesChanged = a.gamma != b.gamma || a.temperature != b.temperature
+                                 || a.exposure != b.exposure;
+
+    if (a.brightness != b.brightness || a.contrast != b.contrast || hsvA != hsvB)
+        return LeadingLutStage;
+    if (!hsvA && pointStagesChanged)
+        return LeadingLutStage;
+    if (a.saturation != b.saturation)
+        return SaturationStage;
+    if (a.hue != b.hue)
+        return HueStage;
+    if (pointStagesChanged)
+        return TrailingLutStage;
+    if (a.shadows != b.shadows)
+        return ShadowsStage;
+    if (a.highlights != b.highlights)
+        return HighlightsStage;
+    return StageCount;
+}
+
+QImage AdjustmentKernel::apply(const QImage &image) const
+{
+    if (image.isNull() || isIdentity())
+        return image;
+
+    return apply(PixelKernels::workingCopy(image));
+}
+
+QImage AdjustmentKernel::apply(QImage &&image) const
+{
+    if (image.isNull() || isIdentity())
+        return std::move(image);
+
+    return PixelKernels::mapRows(std::move(image), [this](QRgb *line, int, int width) {
+        processRow(line, width);
+    });
+}
+
+void AdjustmentKernel::processRow(QRgb *line, int width) const
+{
+    processRow(line, width, LeadingLutStage, StageCount);
+}
+
+void AdjustmentKernel::processRow(QRgb *line, int width, int firstStage, int endStage) const
+{
+    // Stage by stage over one scanline: the row stays in L1 between stages
+    // and each inner loop is free of per-pixel stage dispatch
+    auto runs = [firstStage, endStage](Stage stage) {
+        return stage >= firstStage && stage < endStage;
+    };
+
+    if (m_hasLeadingLut && runs(LeadingLutStage)) {
+        for (int x = 0; x < width; ++x)
+            line[x] = m_leadingLut.map(line[x]);
+    }
+
+    if (m_hasSaturation && runs(SaturationStage))
+        saturateRow(line, width, m_saturationFactor);
+
+    if (m_hasHue && runs(HueStage))
+        rotateHueRow(line, width, m_hueOffset);
+
+    if (m_hasTrailingLut && runs(TrailingLutStage)) {
+        for (int x = 0; x < width; ++x)
+            line[x] = m_trailingLut.map(line[x]);
+    }
+
+    if (m_hasShadows && runs(ShadowsStage)) {
+        for (int x = 0; x < width; ++x)
+            line[x] = liftShadows(line[x], m_shadowsFactor);
+    }
+
+    if (m_hasHighlights && runs(HighlightsStage)) {
+        for (int x = 0; x < width; ++x)
+            line[x] = compressHighlights(line[x], m_highlightsFactor);
+    }
+}
@@ -0,0 +1,127 @@
+#ifndef ADJUSTMENTKERNEL_H
+#define ADJUSTMENTKERNEL_H
+
+#include <QImage>
+#include <QRgb>
+#include "adjustmentlut.h"
+#include "exacthsv.h"
+#include "pixelkernels.h"
+
+/**
+ * @class AdjustmentKernel
+ * @brief Runs the whole adjustment chain in a single pass over the image
+ *
+ * Running the chain one ImageProcessor call at a time allocates a full copy
+ * of the image per stage and streams every pixel through memory once per
+ * stage. AdjustmentKernel makes one working copy and runs every active
+ * stage on a scanline while it is still in cache, in the same order and
+ * with the same per-pixel arithmetic as the single-step calls:
+ * leadingLut, saturation, hue, trailingLut, shadows, highlights.
+ *
+ * The stage functions are public so that the single-step ImageProcessor
+ * calls share them and cannot drift apart.
+ *
+ * Stages can also be run as a range [firstStage, endStage), so a caller
+ * holding the output of the leading stages only runs the rest of them.
+ */
+class AdjustmentKernel
+{
+public:
+    // Stages in chain order
+    enum Stage {
+        LeadingLutStage,
+        SaturationStage,
+        HueStage,
+        TrailingLutStage,
+        ShadowsStage,
+        HighlightsStage,
+        StageCount
+    };
+
+    explicit AdjustmentKernel(const CompiledAdjustments &compiled);
+
+    // True when no stage is active
+    bool isIdentity() const;
+
+    // True when a stage in [firstStage, endStage) is active
+    bool hasStages(int firstStage, int endStage) const;
+
+    // Apply all active stages to a copy of the image in one traversal
+    QImage apply(const QImage &image) const;
+
+    // Same, in the buffer of the image when it is not shared
+    QImage apply(QImage &&image) const;
+
+    // Apply all active stages to one scanline in place
+    void processRow(QRgb *line, int width) const;
+
+    // Apply the active stages in [firstStage, endStage) to one scanline in place
+    void processRow(QRgb *line, int width, int firstStage, int endStage) const;
+
+    /**
+     * First stage whose output differs between two parameter sets
+     * Brightness and contrast always land in the leading table; gamma,
+     * temperature and exposure too unless saturation or hue is active.
+     * @return StageCount when every stage produces the same output
+     */
+    static int firstChangedStage(const AdjustmentParameters &a, const AdjustmentParameters &b);
+
+    // Stages, parameters are the clamped slider values. The HSV stages run
+    // on whole scanlines so the conversions vectorize
+    static inline void saturateRow(QRgb *line, int width, double factor)
+    {
+        ExactHsv::saturateRow(line, width, factor);
+    }
+
+    static inline void rotateHueRow(QRgb *line, int width, int hue)
+    {
+        ExactHsv::rotateHueRow(line, width, hue);
+    }
+
+    static inline QRgb liftShadows(QRgb pixel, double factor)
+    {
+        double luminance = (0.299 * qRed(pixel) + 0.587 * qGreen(pixel) + 0.114 * qBlue(pixel)) / 255.0;
+        if (luminance >= 0.5) // Only shadow areas are touched
+            return pixel;
+
+        double shadowFactor = 1.0 + factor * (1.0 - luminance * 2.0);
+        int r = PixelKernels::clampChannel(static_cast<int>(qRed(pixel) * shadowFactor));
+        int g = PixelKernels::clampChannel(static_cast<int>(qGreen(pixel) * shadowFactor));
+        int b = PixelKernels::clampChannel(static_cast<int>(qBlue(pixel) * shadowFactor));
+        return qRgba(r, g, b, qAlpha(pixel));
+    }
+
+    static inline QRgb compressHighlights(QRgb pixel, double factor)
+    {
+        double luminance = (0.299 * qRed(pixel) + 0.587 * qGreen(pixel) + 0.114 * qBlue(pixel)) / 255.0;
+        if (luminance <= 0.5) // Only highlight areas are touched
+            return pixel;
+
+        double highlightFactor = 1.0 - factor * (luminance * 2.0 - 1.0);
+        int r = PixelKernels::clampChannel(static_cast<int>(qRed(pixel) * highlightFactor));
+        int g = PixelKernels::clampChannel(static_cast<int>(qGreen(pixel) * highlightFactor));
+        int b = PixelKernels::clampChannel(static_cast<int>(qBlue(pixel) * highlightFactor));
+        return qRgba(r, g, b, qAlpha(pixel));
+    }
+
+    // Slider value -> factor, same clamping as the single-step calls
+    static double saturationFactor(int saturation) { return 1.0 + qBound(-100, saturation, 100) / 100.0; }
+    static int hueOffset(int hue) { return qBound(-180, hue, 180); }
+    static double toneFactor(int amount) { return qBound(-100, amount, 100) / 100.0; }
+
+private:
+    ChannelLut m_leadingLut;
+    ChannelLut m_trailingLut;
+    bool m_hasLeadingLut;
+    bool m_hasTrailingLut;
+    bool m_hasSaturation;
+    bool m_hasHue;
+    bool m_hasShadows;
+    bool m_hasHighlights;
+    double m_saturationFactor;
+    int m_hueOffset;
+    double m_shadowsFactor;
+    double m_highlightsFactor;
+};
+
+#endif // ADJUSTMENTKERNEL_H
@@ -0,0 +1,198 @@
+#include "adjustmentlut.h"
+#include "pixelkernels.h"
+#include <QtMath>
+
+// ChannelLut
+ChannelLut::ChannelLut()
+    : m_identity(true)
+{
+    for (int i = 0; i < 256; ++i) {
+        m_red[i] = static_cast<uchar>(i);
+        m_green[i] = static_cast<uchar>(i);
+        m_blue[i] = static_cast<uchar>(i);
+    }
+}
+
+ChannelLut ChannelLut::brightness(int brightness)
+{
+    brightness = qBound(-100, brightness, 100);
+
+    ChannelLut lut;
+    for (int i = 0; i < 256; ++i) {
+        const uchar value = static_cast<uchar>(PixelKernels::clampChannel(i + brightness));
+        lut.m_red[i] = lut.m_green[i] = lut.m_blue[i] = value;
+    }
+    lut.updateIdentity();
+    return lut;
+}
+
+ChannelLut ChannelLut::contrast(int contrast)
+{
+    contrast = qBound(-100, contrast, 100);
+    double factor = (259.0 * (contrast + 255)) / (255.0 * (259 - contrast));
+
+    ChannelLut lut;
+    for (int i = 0; i < 256; ++i) {
+        const uchar value = static_cast<uchar>(
+            PixelKernels::clampChannel(static_cast<int>(factor * (i - 128) + 128)));
+        lut.m_red[i] = lut.m_green[i] = lut.m_blue[i] = value;
+    }
+    lut.updateIdentity();
+    return lut;
+}
+
+ChannelLut ChannelLut::gamma(double gamma)
+{
+    gamma = qBound(0.1, gamma, 10.0);
+
+    ChannelLut lut;
+    for (int i = 0; i < 256; ++i) {
+        const uchar value = static_cast<uchar>(
+            qBound(0, static_cast<int>(255 * qPow(i / 255.0, 1.0 / gamma)), 255));
+        lut.m_red[i] = lut.m_green[i] = lut.m_blue[i] = value;
+    }
+    lut.updateIdentity();
+    return lut;
+}
+
+ChannelLut ChannelLut::colorTemperature(int temperature)
+{
+    temperature = qBound(-100, temperature, 100);
+
+    ChannelLut lut;
+    for (int i = 0; i < 256; ++i) {
+        if (temperature > 0) {
+            // Warmer (more red/yellow)
+            lut.m_green[i] = static_cast<uchar>(PixelKernels::clampChannel(i - temperature / 2));
+            lut.m_blue[i] = static_cast<uchar>(PixelKernels::clampChannel(i - temperature));
+        } else if (temperature < 0) {
+            // Cooler (more blue)
+            lut.m_red[i] = static_cast<uchar>(PixelKernels::clampChannel(i + temperature));
+            lut.m_green[i] = static_cast<uchar>(PixelKernels::clampChannel(i + temperature / 2));
+        }
+    }
+    lut.updateIdentity();
+    return lut;
+}
+
+ChannelLut ChannelLut::exposure(int exposure)
+{
+    exposure = qBound(-100, exposure, 100);
+    double factor = qPow(2.0, exposure / 50.0);
+
+    ChannelLut lut;
+    for (int i = 0; i < 256; ++i) {
+        const uchar value = static_cast<uchar>(
+            PixelKernels::clampChannel(static_cast<int>(i * factor)));
+        lut.m_red[i] = lut.m_green[i] = lut.m_blue[i] = value;
+    }
+    lut.updateIdentity();
+    return lut;
+}
+
+ChannelLut ChannelLut::then(const ChannelLut &next) const
+{
+    if (m_identity)
+        return next;
+    if (next.m_identity)
+        return *this;
+
+    ChannelLut lut;
+    for (int i = 0; i < 256; ++i) {
+        lut.m_red[i] = next.m_red[m_red[i]];
+        lut.m_green[i] = next.m_green[m_green[i]];
+        lut.m_blue[i] = next.m_blue[m_blue[i]];
+    }
+    lut.updateIdentity();
+    return lut;
+}
+
+QImage ChannelLut::apply(const QImage &image) const
+{
+    return apply(PixelKernels::workingCopy(image));
+}
+
+QImage ChannelLut::apply(QImage &&image) const
+{
+    return PixelKernels::mapPixels(std::move(image), [this](QRgb pixel) {
+        return map(pixel);
+    });
+}
+
+void ChannelLut::updateIdentity()
+{
+    m_identity = true;
+    for (int i = 0; i < 256 && m_identity; ++i) {
+        m_identity = m_red[i] == i && m_green[i] == i && m_blue[i] == i;
+    }
+}
+
+// AdjustmentLutCompiler
+AdjustmentLutCompiler::AdjustmentLutCompiler()
+    : m_tableHasHsvStage(false)
+    , m_valid(false)
+{
+}
+
+const CompiledAdjustments &AdjustmentLutCompiler::compile(const AdjustmentParameters &params)
+{
+    if (!m_valid || !tablesMatch(params)) {
+        m_compiled = compileUncached(params);
+        m_tableParams = params;
+        m_tableHasHsvStage = m_compiled.hasHsvStage();
+        m_valid = true;
+    }
+
+    // Non-table stages are cheap to refresh
+    m_compiled.saturation = params.saturation;
+    m_compiled.hue = params.hue;
+    m_compiled.shadows = params.shadows;
+    m_compiled.highlights = params.highlights;
+
+    return m_compiled;
+}
+
+CompiledAdjustments AdjustmentLutCompiler::compileUncached(const AdjustmentParameters &params)
+{
+    CompiledAdjustments compiled;
+    compiled.saturation = params.saturation;
+    compiled.hue = params.hue;
+    compiled.shadows = params.shadows;
+    compiled.highlights = params.highlights;
+
+    // Stages before saturation/hue
+    ChannelLut leading;
+    if (params.brightness != 0)
+        leading = leading.then(ChannelLut::brightness(params.brightness));
+    if (params.contrast != 0)
+        leading = leading.then(ChannelLut::contrast(params.contrast));
+
+    // Stages after saturation/hue
+    ChannelLut trailing;
+    if (qAbs(params.gamma - 1.0) > 0.01)
+        trailing = trailing.then(ChannelLut::gamma(params.gamma));
+    if (params.temperature != 0)
+        trailing = trailing.then(ChannelLut::colorTemperature(params.temperature));
+    if (params.exposure != 0)
+        trailing = trailing.then(ChannelLut::exposure(params.exposure));
+
+    if (compiled.hasHsvStage()) {
+        compiled.leadingLut = leading;
+        compiled.trailingLut = trailing;
+    } else {
+        compiled.leadingLut = leading.then(trailing);
+    }
+
+    return compiled;
+}
+
+bool AdjustmentLutCompiler::tablesMatch(const AdjustmentParameters &params) const
+{
+    const bool hasHsvStage = params.saturation != 0 || params.hue != 0;
+    return hasHsvStage == m_tableHasHsvStage
+        && params.brightness == m_tableParams.brightness
+        && params.contrast == m_tableParams.contrast
+        && params.gamma == m_tableParams.gamma
+        && params.temperature == m_tableParams.temperature
+        && params.exposure == m_tableParams.exposure;
+}
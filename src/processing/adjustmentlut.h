@@ -0,0 +1,108 @@
+#ifndef ADJUSTMENTLUT_H
+#define ADJUSTMENTLUT_H
+
+#include <QImage>
+#include <QRgb>
+#include "../model/adjustmentparameters.h"
+
+/**
+ * @class ChannelLut
+ * @brief Per-channel 256-entry lookup table for point adjustments
+ *
+ * Brightness, contrast, gamma, exposure and color temperature each map an
+ * 8-bit channel value to another 8-bit value independently of the other
+ * channels. Any sequence of such stages can therefore be folded into one
+ * table per channel, and the folded table produces exactly the same bytes
+ * as running the stages one after the other.
+ */
+class ChannelLut
+{
+public:
+    // Identity table
+    ChannelLut();
+
+    // Single-stage tables, same formulas and clamping as ImageProcessor
+    static ChannelLut brightness(int brightness);
+    static ChannelLut contrast(int contrast);
+    static ChannelLut gamma(double gamma);
+    static ChannelLut colorTemperature(int temperature);
+    static ChannelLut exposure(int exposure);
+
+    // Table equivalent to applying this table first, then next
+    ChannelLut then(const ChannelLut &next) const;
+
+    bool isIdentity() const { return m_identity; }
+
+    inline QRgb map(QRgb pixel) const
+    {
+        return qRgba(m_red[qRed(pixel)], m_green[qGreen(pixel)], m_blue[qBlue(pixel)], qAlpha(pixel));
+    }
+
+    // Apply the table to a copy of the image (one memory pass)
+    QImage apply(const QImage &image) const;
+
+    // Same, in the buffer of the image when it is not shared
+    QImage apply(QImage &&image) const;
+
+    const uchar *red() const { return m_red; }
+    const uchar *green() const { return m_green; }
+    const uchar *blue() const { return m_blue; }
+
+private:
+    void updateIdentity();
+
+    uchar m_red[256];
+    uchar m_green[256];
+    uchar m_blue[256];
+    bool m_identity;
+};
+
+/**
+ * @struct CompiledAdjustments
+ * @brief AdjustmentParameters lowered to lookup tables plus the remaining stages
+ *
+ * The adjustment chain runs brightness, contrast, saturation, hue, gamma,
+ * temperature, exposure, shadows, highlights. Saturation and hue mix the
+ * channels, so per-channel stages before them land in leadingLut and the
+ * ones after them in trailingLut. When neither HSV stage is active the
+ * whole per-channel chain is folded into leadingLut alone.
+ */
+struct CompiledAdjustments
+{
+    ChannelLut leadingLut;   // brightness, contrast (+ gamma, temperature, exposure without HSV stages)
+    ChannelLut trailingLut;  // gamma, temperature, exposure after an HSV stage
+    int saturation = 0;
+    int hue = 0;
+    int shadows = 0;
+    int highlights = 0;
+
+    bool hasHsvStage() const { return saturation != 0 || hue != 0; }
+};
+
+/**
+ * @class AdjustmentLutCompiler
+ * @brief Compiles AdjustmentParameters into CompiledAdjustments and caches the tables
+ *
+ * The tables only depend on the per-channel parameters, so they are reused
+ * as long as only saturation, hue, shadows or highlights change.
+ */
+class AdjustmentLutCompiler
+{
+public:
+    AdjustmentLutCompiler();
+
+    const CompiledAdjustments &compile(const AdjustmentParameters &params);
+
+    // Build the tables without touching any cache
+    static CompiledAdjustments compileUncached(const AdjustmentParameters &params);
+
+private:
+    bool tablesMatch(const AdjustmentParameters &params) const;
+
+    CompiledAdjustments m_compiled;
+    AdjustmentParameters m_tableParams;
+    bool m_tableHasHsvStage;
+    bool m_valid;
+};
+
+#endif // ADJUSTMENTLUT_H
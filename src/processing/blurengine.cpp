@@ -0,0 +1,169 @@
+#include "blurengine.h"
+#include "pixelkernels.h"
+#include "parallelrows.h"
+#include "imagebufferpool.h"
+#include <QtMath>
+#include <cstring>
+
+// Rounded sum / window via a reciprocal, exact for the sums a box can reach
+struct BoxDivider
+{
+    explicit BoxDivider(int radius)
+        : half(radius)
+        , reciprocal((Q_UINT64_C(1) << 32) / (2 * radius + 1) + 1)
+    {
+    }
+
+    inline int operator()(int sum) const
+    {
+        return static_cast<int>((static_cast<quint64>(sum + half) * reciprocal) >> 32);
+    }
+
+    int half;
+    quint64 reciprocal;
+};
+
+QImage BlurEngine::gaussian(const QImage &image, int radius)
+{
+    if (image.isNull())
+        return image;
+
+    radius = qBound(1, radius, MaxRadius);
+    const QVector<int> radii = boxRadiiForSigma(sigmaForRadius(radius));
+
+    QImage result = PixelKernels::toWorkingFormat(image);
+    const int width = result.width();
+    const int height = result.height();
+
+    // Horizontal passes: all boxes on one scanline while it is in cache.
+    // Rows are independent, so bands of rows run in parallel.
+    uchar *bits = result.bits();
+    const qsizetype stride = result.bytesPerLine();
+    ParallelRows::forRanges(height, width, [&](int begin, int end) {
+        QVector<QRgb> front(width);
+        QVector<QRgb> back(width);
+        for (int y = begin; y < end; ++y) {
+            QRgb *line = reinterpret_cast<QRgb *>(bits + y * stride);
+            std::memcpy(front.data(), line, width * sizeof(QRgb));
+            for (int boxRadius : radii) {
+                boxRow(front.constData(), back.data(), width, boxRadius);
+                front.swap(back);
+            }
+            std::memcpy(line, front.constData(), width * sizeof(QRgb));
+        }
+    });
+
+    // Vertical passes, ping-ponging between two images. Columns are
+    // independent, so strips of columns run in parallel. The two images
+    // need not share a scanline length (pooled rows are padded), so each
+    // pass takes the target's own.
+    QImage scratch = ImageBufferPool::acquire(result.size(), result.format());
+    for (int boxRadius : radii) {
+        const QImage &source = result;
+        uchar *target = scratch.bits();
+        const qsizetype targetStride = scratch.bytesPerLine();
+        ParallelRows::forRanges(width, height, [&](int begin, int end) {
+            boxColumns(source, target, targetStride, begin, end, boxRadius);
+        });
+        result.swap(scratch);
+    }
+
+    return PixelKernels::restoreFormat(result, image.format());
+}
+
+double BlurEngine::sigmaForRadius(int radius)
+{
+    // Variance of a box of width 2r + 1 is ((2r + 1)^2 - 1) / 12 = r (r + 1) / 3
+    return qSqrt(radius * (radius + 1) / 3.0);
+}
+
+QVector<int> BlurEngine::boxRadiiForSigma(double sigma)
+{
+    // Odd box widths wl and wl + 2, m boxes of the smaller width
+    const int n = Passes;
+    const double variance12 = 12.0 * sigma * sigma;
+    int lower = static_cast<int>(qFloor(qSqrt(variance12 / n + 1.0)));
+    if (lower % 2 == 0)
+        --lower;
+    lower = qMax(1, lower);
+    const int upper = lower + 2;
+
+    const double idealCount = (variance12 - n * lower * lower - 4.0 * n * lower - 3.0 * n) / (-4.0 * lower - 4.0);
+    const int count = qBound(0, qRound(idealCount), n);
+
+    QVector<int> radii;
+    for (int i = 0; i < n; ++i) {
+        const int boxRadius = ((i < count ? lower : upper) - 1) / 2;
+        if (boxRadius > 0) // Width 1 is the identity
+            radii.append(boxRadius);
+    }
+    return radii;
+}
+
+void BlurEngine::boxRow(const QRgb *source, QRgb *target, int width, int radius)
+{
+    const BoxDivider divide(radius);
+    const int last = width - 1;
+
+    int r = 0, g = 0, b = 0, a = 0;
+    for (int i = -radius; i <= radius; ++i) {
+        const QRgb pixel = source[qBound(0, i, last)];
+        r += qRed(pixel);
+        g += qGreen(pixel);
+        b += qBlue(pixel);
+        a += qAlpha(pixel);
+    }
+
+    for (int x = 0; x < width; ++x) {
+        target[x] = qRgba(divide(r), divide(g), divide(b), divide(a));
+
+        // Slide the window: add the entering pixel, drop the leaving one
+        const QRgb entering = source[qMin(x + radius + 1, last)];
+        const QRgb leaving = source[qMax(x - radius, 0)];
+        r += qRed(entering) - qRed(leaving);
+        g += qGreen(entering) - qGreen(leaving);
+        b += qBlue(entering) - qBlue(leaving);
+        a += qAlpha(entering) - qAlpha(leaving);
+    }
+}
+
+void BlurEngine::boxColumns(const QImage &source, uchar *target, qsizetype stride,
+                            int firstColumn, int endColumn, int radius)
+{
+    const BoxDivider divide(radius);
+    const int width = endColumn - firstColumn;
+    const int last = source.height() - 1;
+
+    auto row = [&source, last, firstColumn](int y) {
+        return reinterpret_cast<const QRgb *>(source.constScanLine(qBound(0, y, last))) + firstColumn;
+    };
+
+    // Running sums for every column, four channels interleaved
+    QVector<int> sums(width * 4, 0);
+    int *sum = sums.data();
+    for (int i = -radius; i <= radius; ++i) {
+        const QRgb *line = row(i);
+        for (int x = 0; x < width; ++x) {
+            sum[4 * x] += qRed(line[x]);
+            sum[4 * x + 1] += qGreen(line[x]);
+            sum[4 * x + 2] += qBlue(line[x]);
+            sum[4 * x + 3] += qAlpha(line[x]);
+        }
+    }
+
+    for (int y = 0; y <= last; ++y) {
+        QRgb *out = reinterpret_cast<QRgb *>(target + y * stride) + firstColumn;
+        const QRgb *entering = row(y + radius + 1);
+        const QRgb *leaving = row(y - radius);
+
+        for (int x = 0; x < width; ++x) {
+            int *s = sum + 4 * x;
+            out[x] = qRgba(divide(s[0]), divide(s[1]), divide(s[2]), divide(s[3]));
+
+            s[0] += qRed(entering[x]) - qRed(leaving[x]);
+            s[1] += qGreen(entering[x]) - qGreen(leaving[x]);
+            s[2] += qBlue(entering[x]) - qBlue(leaving[x]);
+            s[3] += qAlpha(entering[x]) - qAlpha(leaving[x]);
+        }
+    }
+}
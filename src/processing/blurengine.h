@@ -0,0 +1,54 @@
+#ifndef BLURENGINE_H
+#define BLURENGINE_H
+
+#include <QImage>
+#include <QRgb>
+#include <QVector>
+
+/**
+ * @class BlurEngine
+ * @brief Gaussian blur whose cost does not depend on the radius
+ *
+ * A Gaussian is approximated by three successive box filters (central
+ * limit theorem), each run as a sliding window: one add and one subtract
+ * per pixel and channel, whatever the window size. The horizontal passes
+ * work on one scanline at a time; the vertical passes keep one running sum
+ * per column and walk the image row by row, so memory is always accessed
+ * in order. Edges are clamped (the border pixel is repeated).
+ *
+ * Rows (horizontal passes) and column strips (vertical passes) are
+ * independent and run on ParallelRows; the output does not depend on
+ * the thread count.
+ *
+ * Pattern: Static utility (no instances)
+ */
+class BlurEngine
+{
+public:
+    static constexpr int MaxRadius = 250;
+    static constexpr int Passes = 3;
+
+    /**
+     * Gaussian blur
+     * @param radius Blur radius in pixels (1 to MaxRadius). The Gaussian has
+     *        the same standard deviation as a single box of that radius,
+     *        so small radii look like the previous box blur.
+     */
+    static QImage gaussian(const QImage &image, int radius);
+
+    // Standard deviation used for a given radius
+    static double sigmaForRadius(int radius);
+
+    // Box radii of the Passes boxes whose combined variance best matches sigma
+    static QVector<int> boxRadiiForSigma(double sigma);
+
+private:
+    static void boxRow(const QRgb *source, QRgb *target, int width, int radius);
+    // Vertical box over columns [firstColumn, endColumn); stride is the target scanline length
+    static void boxColumns(const QImage &source, uchar *target, qsizetype stride,
+                           int firstColumn, int endColumn, int radius);
+
+    BlurEngine() = delete;
+};
+
+#endif // BLURENGINE_H
@@ -0,0 +1,259 @@
+#include "colorlut3d.h"
+#include "pixelkernels.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QObject>
+#include <QTextStream>
+#include <QtMath>
+
+ColorLut3D::ColorLut3D()
+    : m_size(0)
+{
+}
+
+ColorLut3D::ColorLut3D(int size)
+    : m_size(qBound(MinSize, size, MaxSize))
+{
+    m_table.resize(3 * m_size * m_size * m_size);
+    for (int b = 0; b < m_size; ++b) {
+        for (int g = 0; g < m_size; ++g) {
+            for (int r = 0; r < m_size; ++r) {
+                setEntry(r + g * m_size + b * m_size * m_size,
+                         r * 255.0f / (m_size - 1),
+                         g * 255.0f / (m_size - 1),
+                         b * 255.0f / (m_size - 1));
+            }
+        }
+    }
+
+    const float domainMin[3] = {0.0f, 0.0f, 0.0f};
+    const float domainMax[3] = {1.0f, 1.0f, 1.0f};
+    buildAxis(domainMin, domainMax);
+}
+
+QImage ColorLut3D::latticeImage(int size)
+{
+    size = qBound(MinSize, size, MaxSize);
+
+    // x = red index, y = green index + blue index * size
+    QImage lattice(size, size * size, QImage::Format_RGB32);
+    for (int b = 0; b < size; ++b) {
+        for (int g = 0; g < size; ++g) {
+            QRgb *line = reinterpret_cast<QRgb *>(lattice.scanLine(g + b * size));
+            for (int r = 0; r < size; ++r) {
+                line[r] = qRgb(qRound(r * 255.0 / (size - 1)),
+                               qRound(g * 255.0 / (size - 1)),
+                               qRound(b * 255.0 / (size - 1)));
+            }
+        }
+    }
+    return lattice;
+}
+
+ColorLut3D ColorLut3D::fromLatticeImage(const QImage &mapped, int size)
+{
+    size = qBound(MinSize, size, MaxSize);
+    if (mapped.width() != size || mapped.height() != size * size)
+        return ColorLut3D();
+
+    ColorLut3D lut(size);
+    PixelKernels::forEachRow(mapped, [&lut, size](const QRgb *line, int y, int width) {
+        for (int r = 0; r < width; ++r) {
+            lut.setEntry(r + y * size, qRed(line[r]), qGreen(line[r]), qBlue(line[r]));
+        }
+    });
+    return lut;
+}
+
+ColorLut3D ColorLut3D::loadCube(const QString &filePath, QString *errorMessage)
+{
+    auto fail = [errorMessage](const QString &message) {
+        if (errorMessage)
+            *errorMessage = message;
+        return ColorLut3D();
+    };
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return fail(QObject::tr("Cannot open %1: %2").arg(filePath, file.errorString()));
+
+    QString title = QFileInfo(filePath).completeBaseName();
+    int size = 0;
+    float domainMin[3] = {0.0f, 0.0f, 0.0f};
+    float domainMax[3] = {1.0f, 1.0f, 1.0f};
+    QVector<float> values;
+    int lineNumber = 0;
+
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        const QString line = stream.readLine().trimmed();
+        ++lineNumber;
+
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+
+        const QStringList tokens = line.split(QLatin1Char(' '), Qt::SkipEmptyParts);
+        const QString keyword = tokens.first().toUpper();
+
+        if (keyword == "TITLE") {
+            QString quoted = line.mid(5).trimmed();
+            if (quoted.startsWith('"') && quoted.endsWith('"') && quoted.size() >= 2)
+                quoted = quoted.mid(1, quoted.size() - 2);
+            if (!quoted.isEmpty())
+                title = quoted;
+        } else if (keyword == "LUT_1D_SIZE") {
+            return fail(QObject::tr("%1 is a 1D LUT, only 3D LUTs are supported").arg(filePath));
+        } else if (keyword == "LUT_3D_SIZE" && tokens.size() == 2) {
+            size = tokens.at(1).toInt();
+            if (size < MinSize || size > MaxSize)
+                return fail(QObject::tr("Unsupported LUT size %1 (expected %2 to %3)")
+                            .arg(size).arg(MinSize).arg(MaxSize));
+            values.reserve(3 * size * size * size);
+        } else if ((keyword == "DOMAIN_MIN" || keyword == "DOMAIN_MAX") && tokens.size() == 4) {
+            float *domain = keyword == "DOMAIN_MIN" ? domainMin : domainMax;
+            for (int c = 0; c < 3; ++c)
+                domain[c] = tokens.at(c + 1).toFloat();
+        } else if (keyword == "LUT_3D_INPUT_RANGE" && tokens.size() == 3) {
+            for (int c = 0; c < 3; ++c) {
+                domainMin[c] = tokens.at(1).toFloat();
+                domainMax[c] = tokens.at(2).toFloat();
+            }
+        } else if (tokens.size() == 3) {
+            if (size == 0)
+                return fail(QObject::tr("Line %1: table data before LUT_3D_SIZE").arg(lineNumber));
+
+            for (const QString &token : tokens) {
+                bool ok = false;
+                const float value = token.toFloat(&ok);
+                if (!ok)
+                    return fail(QObject::tr("Line %1: invalid value \"%2\"").arg(lineNumber).arg(token));
+                values.append(value);
+            }
+        }
+        // Unknown keywords are ignored, as the format allows
+    }
+
+    if (size == 0)
+        return fail(QObject::tr("%1 has no LUT_3D_SIZE").arg(filePath));
+
+    if (values.size() != 3 * size * size * size)
+        return fail(QObject::tr("Expected %1 table entries, found %2")
+                    .arg(size * size * size).arg(values.size() / 3));
+
+    for (int c = 0; c < 3; ++c) {
+        if (domainMax[c] <= domainMin[c])
+            return fail(QObject::tr("Invalid DOMAIN_MIN/DOMAIN_MAX"));
+    }
+
+    ColorLut3D lut(size);
+    lut.m_title = title;
+    for (int i = 0; i < size * size * size; ++i) {
+        lut.setEntry(i,
+                     values.at(3 * i) * 255.0f,
+                     values.at(3 * i + 1) * 255.0f,
+                     values.at(3 * i + 2) * 255.0f);
+    }
+    lut.buildAxis(domainMin, domainMax);
+    return lut;
+}
+
+QRgb ColorLut3D::map(QRgb pixel) const
+{
+    const int red = qRed(pixel);
+    const int green = qGreen(pixel);
+    const int blue = qBlue(pixel);
+
+    const float fr = m_axisFraction[0].at(red);
+    const float fg = m_axisFraction[1].at(green);
+    const float fb = m_axisFraction[2].at(blue);
+
+    // Entry strides along each axis, in floats
+    const int strideR = 3;
+    const int strideG = 3 * m_size;
+    const int strideB = 3 * m_size * m_size;
+
+    const float *c000 = m_table.constData()
+                        + m_axisIndex[0].at(red) * strideR
+                        + m_axisIndex[1].at(green) * strideG
+                        + m_axisIndex[2].at(blue) * strideB;
+    const float *c111 = c000 + strideR + strideG + strideB;
+
+    // Tetrahedral interpolation: pick the tetrahedron of the cube that
+    // contains the point from the ordering of the three fractions
+    const float *c1;
+    const float *c2;
+    float w0, w1, w2, w3;
+    if (fr > fg) {
+        if (fg > fb) {          // r > g > b
+            c1 = c000 + strideR;
+            c2 = c000 + strideR + strideG;
+            w0 = 1.0f - fr; w1 = fr - fg; w2 = fg - fb; w3 = fb;
+        } else if (fr > fb) {   // r > b >= g
+            c1 = c000 + strideR;
+            c2 = c000 + strideR + strideB;
+            w0 = 1.0f - fr; w1 = fr - fb; w2 = fb - fg; w3 = fg;
+        } else {                // b >= r > g
+            c1 = c000 + strideB;
+            c2 = c000 + strideR + strideB;
+            w0 = 1.0f - fb; w1 = fb - fr; w2 = fr - fg; w3 = fg;
+        }
+    } else {
+        if (fb > fg) {          // b > g >= r
+            c1 = c000 + strideB;
+            c2 = c000 + strideG + strideB;
+            w0 = 1.0f - fb; w1 = fb - fg; w2 = fg - fr; w3 = fr;
+        } else if (fb > fr) {   // g >= b > r
+            c1 = c000 + strideG;
+            c2 = c000 + strideG + strideB;
+            w0 = 1.0f - fg; w1 = fg - fb; w2 = fb - fr; w3 = fr;
+        } else {                // g >= r >= b
+            c1 = c000 + strideG;
+            c2 = c000 + strideR + strideG;
+            w0 = 1.0f - fg; w1 = fg - fr; w2 = fr - fb; w3 = fb;
+        }
+    }
+
+    int out[3];
+    for (int c = 0; c < 3; ++c) {
+        const float value = w0 * c000[c] + w1 * c1[c] + w2 * c2[c] + w3 * c111[c];
+        out[c] = PixelKernels::clampChannel(static_cast<int>(value + 0.5f));
+    }
+    return qRgba(out[0], out[1], out[2], qAlpha(pixel));
+}
+
+QImage ColorLut3D::apply(const QImage &image) const
+{
+    if (isNull())
+        return image;
+
+    return PixelKernels::mapPixels(image, [this](QRgb pixel) {
+        return map(pixel);
+    });
+}
+
+void ColorLut3D::setEntry(int index, float red, float green, float blue)
+{
+    float *entry = m_table.data() + 3 * index;
+    entry[0] = red;
+    entry[1] = green;
+    entry[2] = blue;
+}
+
+void ColorLut3D::buildAxis(const float domainMin[3], const float domainMax[3])
+{
+    for (int c = 0; c < 3; ++c) {
+        m_axisIndex[c].resize(256);
+        m_axisFraction[c].resize(256);
+
+        for (int v = 0; v < 256; ++v) {
+            float t = (v / 255.0f - domainMin[c]) / (domainMax[c] - domainMin[c]);
+            t = qBound(0.0f, t, 1.0f);
+
+            // Last cell is used for t == 1 so that c111 stays inside the table
+            const float position = t * (m_size - 1);
+            const int index = qMin(static_cast<int>(position), m_size - 2);
+            m_axisIndex[c][v] = index;
+            m_axisFraction[c][v] = position - index;
+        }
+    }
+}
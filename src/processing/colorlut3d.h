@@ -0,0 +1,79 @@
+#ifndef COLORLUT3D_H
+#define COLORLUT3D_H
+
+#include <QImage>
+#include <QRgb>
+#include <QString>
+#include <QVector>
+
+/**
+ * @class ColorLut3D
+ * @brief 3D color lookup table with tetrahedral interpolation
+ *
+ * Every stage of the adjustment chain (including the HSV-based saturation
+ * and hue steps and the luminance-gated shadows/highlights) depends only on
+ * the pixel's own RGB value, so the whole chain is a pure RGB -> RGB
+ * function. ColorLut3D samples such a function on an N x N x N lattice and
+ * evaluates it with tetrahedral interpolation, so the cost per pixel is
+ * constant no matter how many stages went into the table.
+ *
+ * ImageProcessor::bakeAdjustments() builds tables from AdjustmentParameters.
+ * The same table type is used for external Adobe/Resolve .cube files.
+ */
+class ColorLut3D
+{
+public:
+    static constexpr int DefaultSize = 33;
+    static constexpr int MinSize = 2;
+    static constexpr int MaxSize = 129;
+
+    // Null table
+    ColorLut3D();
+
+    // Identity table with size entries per axis
+    explicit ColorLut3D(int size);
+
+    /**
+     * Lattice points as an image, one pixel per table entry
+     *
+     * Run any RGB -> RGB operation over this image and pass the result to
+     * fromLatticeImage() to bake the operation into a table.
+     * @param size Entries per axis, 33 or 65 are the usual choices
+     */
+    static QImage latticeImage(int size);
+    static ColorLut3D fromLatticeImage(const QImage &mapped, int size);
+
+    /**
+     * Load a 3D table from a .cube file
+     * @param filePath Path to the .cube file
+     * @param errorMessage Optional output for a human-readable error
+     * @return Loaded table, null table on error
+     */
+    static ColorLut3D loadCube(const QString &filePath, QString *errorMessage = nullptr);
+
+    bool isNull() const { return m_size == 0; }
+    int size() const { return m_size; }
+    QString title() const { return m_title; }
+
+    // Evaluate the table for one pixel (alpha is kept)
+    QRgb map(QRgb pixel) const;
+
+    // Apply the table to a copy of the image
+    QImage apply(const QImage &image) const;
+
+private:
+    void setEntry(int index, float red, float green, float blue);
+    void buildAxis(const float domainMin[3], const float domainMax[3]);
+
+    int m_size;
+    QString m_title;
+
+    // Lattice entries as interleaved RGB in 0..255, red index varies fastest
+    QVector<float> m_table;
+
+    // Per-channel 8-bit input -> lattice cell and fraction
+    QVector<int> m_axisIndex[3];
+    QVector<float> m_axisFraction[3];
+};
+
+#endif // COLORLUT3D_H
@@ -0,0 +1,472 @@
+#include "convolution.h"
+#include "pixelkernels.h"
+#include "parallelrows.h"
+#include "simdkernels.h"
+#include <QObject>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QtMath>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <numeric>
+
+static bool validKernelSize(int size)
+{
+    return size >= 1 && size <= ConvolutionKernel::MaxSize && size % 2 == 1;
+}
+
+// ConvolutionKernel
+ConvolutionKernel::ConvolutionKernel()
+    : m_width(0)
+    , m_height(0)
+    , m_divisor(1)
+    , m_bias(0)
+{
+}
+
+ConvolutionKernel::ConvolutionKernel(int width, int height, const QVector<int> &weights,
+                                     int divisor, int bias)
+    : ConvolutionKernel()
+{
+    if (!validKernelSize(width) || !validKernelSize(height) || weights.size() != width * height
+        || divisor < 1 || qAbs(bias) > 255)
+        return;
+
+    for (int weight : weights) {
+        if (qAbs(weight) > MaxWeight)
+            return;
+    }
+
+    m_width = width;
+    m_height = height;
+    m_weights = weights;
+    m_divisor = divisor;
+    m_bias = bias;
+    detectSeparable();
+}
+
+ConvolutionKernel ConvolutionKernel::separable(const QVector<int> &row, const QVector<int> &column,
+                                               int divisor, int bias)
+{
+    QVector<int> weights;
+    weights.reserve(row.size() * column.size());
+    for (int c : column) {
+        for (int r : row) {
+            const qint64 weight = qint64(c) * r;
+            if (qAbs(weight) > MaxWeight)
+                return ConvolutionKernel();
+            weights.append(static_cast<int>(weight));
+        }
+    }
+    return ConvolutionKernel(row.size(), column.size(), weights, divisor, bias);
+}
+
+ConvolutionKernel ConvolutionKernel::fromText(const QString &text, QString *error)
+{
+    auto fail = [error](const QString &message) {
+        if (error)
+            *error = message;
+        return ConvolutionKernel();
+    };
+
+    static const QRegularExpression separators(QStringLiteral("[\\s,;]+"));
+
+    QVector<int> weights;
+    int width = 0;
+    int height = 0;
+    bool hasDivisor = false;
+    int divisor = 1;
+    int bias = 0;
+
+    const QStringList lines = text.split(QLatin1Char('\n'));
+    for (int i = 0; i < lines.size(); ++i) {
+        QString line = lines.at(i);
+        const int comment = line.indexOf(QLatin1Char('#'));
+        if (comment >= 0)
+            line.truncate(comment);
+
+        const QStringList tokens = line.split(separators, Qt::SkipEmptyParts);
+        if (tokens.isEmpty())
+            continue;
+
+        const QString keyword = tokens.first().toLower();
+        if (keyword == "divisor" || keyword == "bias") {
+            bool ok = false;
+            const int value = tokens.size() == 2 ? tokens.at(1).toInt(&ok) : 0;
+            if (!ok)
+                return fail(QObject::tr("Line %1: expected \"%2 <integer>\"").arg(i + 1).arg(keyword));
+            if (keyword == "divisor") {
+                divisor = value;
+                hasDivisor = true;
+            } else {
+                bias = value;
+            }
+            continue;
+        }
+
+        if (width == 0)
+            width = tokens.size();
+        else if (tokens.size() != width)
+            return fail(QObject::tr("Line %1: expected %2 weights, found %3")
+                        .arg(i + 1).arg(width).arg(tokens.size()));
+
+        for (const QString &token : tokens) {
+            bool ok = false;
+            const int weight = token.toInt(&ok);
+            if (!ok)
+                return fail(QObject::tr("Line %1: \"%2\" is not an integer").arg(i + 1).arg(token));
+            if (qAbs(weight) > MaxWeight)
+                return fail(QObject::tr("Line %1: weights must be between -%2 and %2")
+                            .arg(i + 1).arg(MaxWeight));
+            weights.append(weight);
+        }
+        ++height;
+    }
+
+    if (height == 0)
+        return fail(QObject::tr("The kernel has no weights"));
+    if (!validKernelSize(width) || !validKernelSize(height))
+        return fail(QObject::tr("Kernel size %1x%2 is not supported (odd sizes up to %3x%3)")
+                    .arg(width).arg(height).arg(MaxSize));
+
+    if (!hasDivisor) {
+        const int sum = std::accumulate(weights.cbegin(), weights.cend(), 0);
+        divisor = sum > 0 ? sum : 1;
+    }
+    if (divisor < 1)
+        return fail(QObject::tr("The divisor must be positive"));
+    if (qAbs(bias) > 255)
+        return fail(QObject::tr("The bias must be between -255 and 255"));
+
+    return ConvolutionKernel(width, height, weights, divisor, bias);
+}
+
+ConvolutionKernel ConvolutionKernel::sharpen()
+{
+    return ConvolutionKernel(3, 3, {0, -1, 0, -1, 5, -1, 0, -1, 0});
+}
+
+ConvolutionKernel ConvolutionKernel::sobelX()
+{
+    return separable({-1, 0, 1}, {1, 2, 1});
+}
+
+ConvolutionKernel ConvolutionKernel::sobelY()
+{
+    return separable({1, 2, 1}, {-1, 0, 1});
+}
+
+QString ConvolutionKernel::toText() const
+{
+    QStringList lines;
+    for (int y = 0; y < m_height; ++y) {
+        QStringList row;
+        for (int x = 0; x < m_width; ++x)
+            row << QString::number(weight(x, y));
+        lines << row.join(' ');
+    }
+    lines << QString("divisor %1").arg(m_divisor);
+    if (m_bias != 0)
+        lines << QString("bias %1").arg(m_bias);
+    return lines.join('\n');
+}
+
+void ConvolutionKernel::detectSeparable()
+{
+    // Pivot: first row with a non-zero weight, reduced by the gcd of its
+    // entries. A rank-1 integer matrix has every row an integer multiple of it.
+    int pivot = -1;
+    for (int y = 0; y < m_height && pivot < 0; ++y) {
+        for (int x = 0; x < m_width; ++x) {
+            if (weight(x, y) != 0) {
+                pivot = y;
+                break;
+            }
+        }
+    }
+    if (pivot < 0)
+        return;
+
+    int common = 0;
+    for (int x = 0; x < m_width; ++x)
+        common = std::gcd(common, weight(x, pivot));
+
+    QVector<int> row(m_width);
+    int lead = -1;
+    for (int x = 0; x < m_width; ++x) {
+        row[x] = weight(x, pivot) / common;
+        if (lead < 0 && row[x] != 0)
+            lead = x;
+    }
+
+    QVector<int> column(m_height);
+    for (int y = 0; y < m_height; ++y) {
+        if (weight(lead, y) % row[lead] != 0)
+            return;
+        const int scale = weight(lead, y) / row[lead];
+        for (int x = 0; x < m_width; ++x) {
+            if (scale * row[x] != weight(x, y))
+                return;
+        }
+        column[y] = scale;
+    }
+
+    m_row = row;
+    m_column = column;
+}
+
+namespace {
+
+// Raw byte plane: 4 bytes per pixel for 32-bit working images, 1 for Grayscale8
+struct Plane
+{
+    const uchar *bits;
+    qsizetype stride;
+    int width;
+    int height;
+    int channels;
+};
+
+/**
+ * Tap sums for one band of output rows
+ *
+ * Holds the padded source row and, for separable kernels, a ring of
+ * horizontally filtered rows, so one instance must not be shared
+ * between threads.
+ */
+class RowConvolver
+{
+public:
+    RowConvolver(const Plane &plane, const ConvolutionKernel &kernel, Convolution::BorderMode border)
+        : m_plane(plane)
+        , m_kernel(kernel)
+        , m_border(border)
+        , m_count(plane.width * plane.channels)
+        , m_centerX(kernel.width() / 2)
+        , m_centerY(kernel.height() / 2)
+        , m_separable(kernel.isSeparable() && kernel.width() > 1 && kernel.height() > 1
+                      && kernel.width() * kernel.height() >= 25)
+        , m_sums(m_count)
+    {
+        const int paddedWidth = plane.width + kernel.width() - 1;
+        m_padded.resize(paddedWidth * plane.channels);
+        m_columns.resize(paddedWidth);
+        for (int x = 0; x < paddedWidth; ++x)
+            m_columns[x] = Convolution::borderIndex(x - m_centerX, plane.width, border);
+
+        if (m_separable) {
+            m_ring.resize(kernel.height() * m_count);
+            m_ringRows.fill(INT_MIN, kernel.height());
+        }
+    }
+
+    // Sums for output row y, width * channels values in memory byte order
+    const int *row(int y)
+    {
+        int *sums = m_sums.data();
+        std::fill(sums, sums + m_count, 0);
+
+        const int height = m_kernel.height();
+        if (m_separable) {
+            const QVector<int> &column = m_kernel.columnWeights();
+            for (int ky = 0; ky < height; ++ky) {
+                if (column[ky] != 0)
+                    SimdKernels::accumulateInts(sums, filteredRow(y + ky - m_centerY), m_count, column[ky]);
+            }
+            return sums;
+        }
+
+        const int width = m_kernel.width();
+        const int channels = m_plane.channels;
+        for (int ky = 0; ky < height; ++ky) {
+            const uchar *padded = nullptr;
+            for (int kx = 0; kx < width; ++kx) {
+                const int weight = m_kernel.weight(kx, ky);
+                if (weight == 0)
+                    continue;
+                if (!padded)
+                    padded = paddedRow(y + ky - m_centerY);
+                SimdKernels::accumulateBytes(sums, padded + kx * channels, m_count, weight);
+            }
+        }
+        return sums;
+    }
+
+private:
+    // Source row with the left and right border filled in
+    const uchar *paddedRow(int y)
+    {
+        const uchar *source = m_plane.bits + Convolution::borderIndex(y, m_plane.height, m_border) * m_plane.stride;
+        if (m_centerX == 0)
+            return source;
+
+        const int channels = m_plane.channels;
+        uchar *padded = m_padded.data();
+        std::memcpy(padded + m_centerX * channels, source, m_count);
+        for (int x = 0; x < m_centerX; ++x) {
+            const int right = m_centerX + m_plane.width + x;
+            std::memcpy(padded + x * channels, source + m_columns[x] * channels, channels);
+            std::memcpy(padded + right * channels, source + m_columns[right] * channels, channels);
+        }
+        return padded;
+    }
+
+    // Horizontal pass of a separable kernel, cached per virtual row
+    const int *filteredRow(int y)
+    {
+        const int height = m_kernel.height();
+        const int slot = ((y % height) + height) % height;
+        int *filtered = m_ring.data() + slot * m_count;
+        if (m_ringRows[slot] == y)
+            return filtered;
+
+        std::fill(filtered, filtered + m_count, 0);
+        const QVector<int> &row = m_kernel.rowWeights();
+        const uchar *padded = paddedRow(y);
+        for (int kx = 0; kx < row.size(); ++kx) {
+            if (row[kx] != 0)
+                SimdKernels::accumulateBytes(filtered, padded + kx * m_plane.channels, m_count, row[kx]);
+        }
+        m_ringRows[slot] = y;
+        return filtered;
+    }
+
+    const Plane &m_plane;
+    const ConvolutionKernel &m_kernel;
+    const Convolution::BorderMode m_border;
+    const int m_count;
+    const int m_centerX;
+    const int m_centerY;
+    const bool m_separable;
+    QVector<int> m_sums;
+    QVector<uchar> m_padded;
+    QVector<int> m_columns;
+    QVector<int> m_ring;
+    QVector<int> m_ringRows;
+};
+
+// Round half up, also for negative sums
+inline int divideRounded(int sum, int divisor)
+{
+    if (divisor == 1)
+        return sum;
+
+    const qint64 numerator = 2 * qint64(sum) + divisor;
+    const qint64 denominator = 2 * qint64(divisor);
+    return static_cast<int>(numerator >= 0 ? numerator / denominator
+                                           : -((-numerator + denominator - 1) / denominator));
+}
+
+} // namespace
+
+// Convolution
+QImage Convolution::apply(const QImage &image, const ConvolutionKernel &kernel, BorderMode border)
+{
+    if (image.isNull() || kernel.isNull())
+        return image;
+
+    const QImage::Format format = PixelKernels::workingFormat(image);
+    const QImage source = image.format() == format ? image : image.convertToFormat(format);
+    QImage result(source.size(), format);
+
+    const Plane plane = { source.constBits(), source.bytesPerLine(), source.width(), source.height(), 4 };
+    uchar *resultBits = result.bits();
+    const qsizetype stride = result.bytesPerLine();
+    const int divisor = kernel.divisor();
+    const int bias = kernel.bias();
+
+    ParallelRows::forRanges(plane.height, plane.width, [&](int begin, int end) {
+        RowConvolver convolver(plane, kernel, border);
+        for (int y = begin; y < end; ++y) {
+            const int *sums = convolver.row(y);
+            const QRgb *in = reinterpret_cast<const QRgb *>(plane.bits + y * plane.stride);
+            QRgb *out = reinterpret_cast<QRgb *>(resultBits + y * stride);
+
+            for (int x = 0; x < plane.width; ++x) {
+                // Sums are in memory byte order, rebuild the pixel the same way
+                uchar bytes[4];
+                for (int c = 0; c < 4; ++c)
+                    bytes[c] = static_cast<uchar>(PixelKernels::clampChannel(divideRounded(sums[4 * x + c], divisor) + bias));
+                QRgb pixel;
+                std::memcpy(&pixel, bytes, sizeof(pixel));
+
+                // Keep original alpha channel
+                out[x] = (pixel & 0x00ffffff) | (in[x] & 0xff000000);
+            }
+        }
+    });
+
+    return PixelKernels::restoreFormat(result, image.format());
+}
+
+QImage Convolution::gradientMagnitude(const QImage &image, const ConvolutionKernel &horizontal,
+                                      const ConvolutionKernel &vertical, double scale,
+                                      BorderMode border)
+{
+    if (image.isNull() || horizontal.isNull() || vertical.isNull())
+        return image;
+
+    const QImage source = image.format() == QImage::Format_Grayscale8
+                          ? image
+                          : image.convertToFormat(QImage::Format_Grayscale8);
+    QImage result(source.size(), QImage::Format_Grayscale8);
+
+    const Plane plane = { source.constBits(), source.bytesPerLine(), source.width(), source.height(), 1 };
+    uchar *resultBits = result.bits();
+    const qsizetype stride = result.bytesPerLine();
+
+    ParallelRows::forRanges(plane.height, plane.width, [&](int begin, int end) {
+        RowConvolver gx(plane, horizontal, border);
+        RowConvolver gy(plane, vertical, border);
+        for (int y = begin; y < end; ++y) {
+            const int *sumsX = gx.row(y);
+            const int *sumsY = gy.row(y);
+            uchar *out = resultBits + y * stride;
+
+            for (int x = 0; x < plane.width; ++x) {
+                const double dx = divideRounded(sumsX[x], horizontal.divisor());
+                const double dy = divideRounded(sumsY[x], vertical.divisor());
+                const int magnitude = static_cast<int>(qSqrt(dx * dx + dy * dy) / scale);
+                out[x] = static_cast<uchar>(PixelKernels::clampChannel(magnitude));
+            }
+        }
+    });
+
+    return result;
+}
+
+int Convolution::borderIndex(int index, int size, BorderMode border)
+{
+    if (index >= 0 && index < size)
+        return index;
+
+    switch (border) {
+    case Mirror: {
+        if (size == 1)
+            return 0;
+        const int period = 2 * (size - 1);
+        index %= period;
+        if (index < 0)
+            index += period;
+        return index < size ? index : period - index;
+    }
+    case Wrap:
+        index %= size;
+        return index < 0 ? index + size : index;
+    default:
+        return index < 0 ? 0 : size - 1;
+    }
+}
+
+QString Convolution::borderModeName(BorderMode border)
+{
+    switch (border) {
+    case Mirror:
+        return QObject::tr("Mirror");
+    case Wrap:
+        return QObject::tr("Wrap");
+    default:
+        return QObject::tr("Clamp");
+    }
+}
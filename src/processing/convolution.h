@@ -0,0 +1,135 @@
+#ifndef CONVOLUTION_H
+#define CONVOLUTION_H
+
+#include <QImage>
+#include <QString>
+#include <QVector>
+
+/**
+ * @class ConvolutionKernel
+ * @brief Integer convolution kernel with an optional separable form
+ *
+ * Weights are integers in the 16-bit range; the result of a tap sum is
+ * divided by divisor() (rounded to nearest) and offset by bias(). Real
+ * valued kernels are expressed with a common divisor, e.g. a 3x3 box is
+ * all ones with divisor 9. Width and height are odd, at most MaxSize.
+ *
+ * Kernels whose weight matrix is an outer product of two integer vectors
+ * (Sobel, binomial blurs, ...) are detected on construction and keep the
+ * row/column factors, so the engine can run them as two 1D passes.
+ *
+ * The kernel is applied as a correlation: weight(0, 0) multiplies the
+ * pixel at the top-left of the window, as in the original 3x3 filters.
+ */
+class ConvolutionKernel
+{
+public:
+    static constexpr int MaxSize = 15;
+    static constexpr int MaxWeight = 32767;
+
+    // Null kernel
+    ConvolutionKernel();
+
+    // Row-major weights, width * height entries; null if invalid
+    ConvolutionKernel(int width, int height, const QVector<int> &weights,
+                      int divisor = 1, int bias = 0);
+
+    // Outer product column x row; null if invalid
+    static ConvolutionKernel separable(const QVector<int> &row, const QVector<int> &column,
+                                       int divisor = 1, int bias = 0);
+
+    /**
+     * Parse a kernel typed by the user
+     *
+     * One row of whitespace or comma separated integers per line, optional
+     * "divisor N" and "bias N" lines, '#' starts a comment. Without a
+     * divisor line the divisor is the sum of the weights (1 if that sum
+     * is not positive), so smoothing kernels keep the brightness.
+     * @param error Set to a readable message when parsing fails
+     * @return Null kernel on error
+     */
+    static ConvolutionKernel fromText(const QString &text, QString *error = nullptr);
+
+    // Built-in kernels
+    static ConvolutionKernel sharpen();
+    static ConvolutionKernel sobelX();
+    static ConvolutionKernel sobelY();
+
+    bool isNull() const { return m_width == 0; }
+    bool isSeparable() const { return !m_row.isEmpty(); }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    int weight(int x, int y) const { return m_weights[y * m_width + x]; }
+    const QVector<int> &weights() const { return m_weights; }
+    int divisor() const { return m_divisor; }
+    int bias() const { return m_bias; }
+
+    // Separable factors, empty when the kernel is not separable
+    const QVector<int> &rowWeights() const { return m_row; }
+    const QVector<int> &columnWeights() const { return m_column; }
+
+    QString toText() const;
+
+private:
+    void detectSeparable();
+
+    int m_width;
+    int m_height;
+    QVector<int> m_weights;
+    QVector<int> m_row;
+    QVector<int> m_column;
+    int m_divisor;
+    int m_bias;
+};
+
+/**
+ * @class Convolution
+ * @brief Convolution engine on raw scanlines
+ *
+ * Each output row is built by padding the needed source rows once
+ * according to the border mode and adding every non-zero tap with the
+ * SimdKernels multiply-add rows, so all taps of a row run as SSE2/AVX2
+ * loops over contiguous memory with 32-bit integer accumulators (exact
+ * for any valid kernel). Separable kernels of 5x5 and up run as a
+ * horizontal pass into integer rows followed by a vertical pass.
+ *
+ * Rows are split over ParallelRows bands; every band reads the shared
+ * source, so halo rows never see filtered values.
+ *
+ * Pattern: Static utility (no instances)
+ */
+class Convolution
+{
+public:
+    enum BorderMode {
+        Clamp,   // Repeat the edge pixel
+        Mirror,  // Reflect around the edge pixel (dcb|abcd|cba)
+        Wrap     // Tile the image
+    };
+
+    /**
+     * Convolve the color channels, alpha is kept
+     * @return Image in the input format (32-bit for indexed/mono input)
+     */
+    static QImage apply(const QImage &image, const ConvolutionKernel &kernel,
+                        BorderMode border = Clamp);
+
+    /**
+     * Gradient magnitude of the grayscale image:
+     * clamp(int(sqrt(gx^2 + gy^2) / scale))
+     * @return Format_Grayscale8 image
+     */
+    static QImage gradientMagnitude(const QImage &image, const ConvolutionKernel &horizontal,
+                                    const ConvolutionKernel &vertical, double scale,
+                                    BorderMode border = Clamp);
+
+    // Source index for a possibly out-of-range coordinate
+    static int borderIndex(int index, int size, BorderMode border);
+
+    static QString borderModeName(BorderMode border);
+
+private:
+    Convolution() = delete;
+};
+
+#endif // CONVOLUTION_H
@@ -0,0 +1,162 @@
+#include "imagebufferpool.h"
+#include <QColorSpace>
+#include <QMutex>
+#include <QVector>
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace {
+
+struct Buffer
+{
+    uchar *data;
+    qint64 bytes;
+    QSize size;
+    QImage::Format format;
+};
+
+struct PoolState
+{
+    QMutex mutex;
+    QVector<Buffer*> idle;  // Oldest first
+    qint64 idleBudget = ImageBufferPool::DefaultIdleBudget;
+    ImageBufferPool::Stats stats;
+};
+
+// Deliberately leaked: pooled images may be released during static destruction
+PoolState &state()
+{
+    static PoolState *const instance = new PoolState;
+    return *instance;
+}
+
+void freeBuffer(Buffer *buffer)
+{
+    ::operator delete(buffer->data, std::align_val_t(ImageBufferPool::Alignment));
+    delete buffer;
+}
+
+// Caller holds the mutex
+void evictIdle(PoolState &pool, qint64 budget)
+{
+    while (pool.stats.idleBytes > budget && !pool.idle.isEmpty()) {
+        Buffer *oldest = pool.idle.takeFirst();
+        pool.stats.idleBytes -= oldest->bytes;
+        freeBuffer(oldest);
+    }
+}
+
+// QImage cleanup function, runs when the last copy of a pooled image goes
+void releaseBuffer(void *info)
+{
+    Buffer *buffer = static_cast<Buffer*>(info);
+    PoolState &pool = state();
+    QMutexLocker locker(&pool.mutex);
+    pool.stats.inUseBytes -= buffer->bytes;
+    pool.stats.idleBytes += buffer->bytes;
+    pool.idle.append(buffer);
+    evictIdle(pool, pool.idleBudget);
+}
+
+qsizetype alignedBytesPerLine(int width, QImage::Format format)
+{
+    const qsizetype rowBytes = (qsizetype(width) * QImage::toPixelFormat(format).bitsPerPixel() + 7) / 8;
+    return (rowBytes + ImageBufferPool::Alignment - 1) / ImageBufferPool::Alignment * ImageBufferPool::Alignment;
+}
+
+} // namespace
+
+QImage ImageBufferPool::acquire(const QSize &size, QImage::Format format)
+{
+    if (size.isEmpty() || format == QImage::Format_Invalid)
+        return QImage();
+
+    const qsizetype bytesPerLine = alignedBytesPerLine(size.width(), format);
+    const qint64 bytes = qint64(bytesPerLine) * size.height();
+    if (bytes < MinPooledBytes)
+        return QImage(size, format);
+
+    PoolState &pool = state();
+    Buffer *buffer = nullptr;
+    {
+        QMutexLocker locker(&pool.mutex);
+        // Most recently returned first, it is the most likely to still be cached
+        for (int i = pool.idle.size() - 1; i >= 0; --i) {
+            Buffer *candidate = pool.idle.at(i);
+            if (candidate->size == size && candidate->format == format) {
+                buffer = candidate;
+                pool.idle.remove(i);
+                pool.stats.idleBytes -= bytes;
+                ++pool.stats.reuses;
+                break;
+            }
+        }
+        if (!buffer)
+            ++pool.stats.allocations;
+        pool.stats.inUseBytes += bytes;
+        pool.stats.highWaterBytes = std::max(pool.stats.highWaterBytes,
+                                             pool.stats.inUseBytes + pool.stats.idleBytes);
+    }
+
+    if (!buffer) {
+        uchar *data = static_cast<uchar*>(::operator new(bytes, std::align_val_t(Alignment), std::nothrow));
+        if (!data) {
+            QMutexLocker locker(&pool.mutex);
+            pool.stats.inUseBytes -= bytes;
+            return QImage();
+        }
+        buffer = new Buffer{data, bytes, size, format};
+    }
+
+    return QImage(buffer->data, size.width(), size.height(), bytesPerLine, format,
+                  releaseBuffer, buffer);
+}
+
+QImage ImageBufferPool::copy(const QImage &image)
+{
+    if (image.isNull())
+        return image;
+
+    QImage result = acquire(image.size(), image.format());
+    if (result.isNull())
+        return image.copy();
+
+    const qsizetype rowBytes = (qsizetype(image.width()) * image.depth() + 7) / 8;
+    uchar *bits = result.bits();
+    const qsizetype stride = result.bytesPerLine();
+    for (int y = 0; y < image.height(); ++y)
+        std::memcpy(bits + y * stride, image.constScanLine(y), rowBytes);
+
+    result.setColorTable(image.colorTable());
+    result.setColorSpace(image.colorSpace());
+    result.setDotsPerMeterX(image.dotsPerMeterX());
+    result.setDotsPerMeterY(image.dotsPerMeterY());
+    result.setDevicePixelRatio(image.devicePixelRatio());
+    result.setOffset(image.offset());
+    for (const QString &key : image.textKeys())
+        result.setText(key, image.text(key));
+    return result;
+}
+
+ImageBufferPool::Stats ImageBufferPool::stats()
+{
+    PoolState &pool = state();
+    QMutexLocker locker(&pool.mutex);
+    return pool.stats;
+}
+
+void ImageBufferPool::setIdleBudget(qint64 bytes)
+{
+    PoolState &pool = state();
+    QMutexLocker locker(&pool.mutex);
+    pool.idleBudget = std::max<qint64>(0, bytes);
+    evictIdle(pool, pool.idleBudget);
+}
+
+void ImageBufferPool::trim()
+{
+    PoolState &pool = state();
+    QMutexLocker locker(&pool.mutex);
+    evictIdle(pool, 0);
+}
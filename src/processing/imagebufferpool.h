@@ -0,0 +1,62 @@
+#ifndef IMAGEBUFFERPOOL_H
+#define IMAGEBUFFERPOOL_H
+
+#include <QImage>
+#include <QSize>
+
+/**
+ * @class ImageBufferPool
+ * @brief Reusable, aligned pixel buffers for intermediate images
+ *
+ * Preview frames, stage outputs and pyramid levels are large images that
+ * live briefly and come back with the same size and format, frame after
+ * frame. acquire() wraps a pooled buffer in a QImage whose cleanup
+ * function hands the buffer back to the pool once the last copy of the
+ * image is gone, on whatever thread that happens; the next request of the
+ * same size and format gets it again instead of a fresh heap allocation.
+ *
+ * Buffers start on an Alignment boundary and every scanline is padded to
+ * a multiple of Alignment, so SIMD rows never straddle a cache line.
+ * Images below MinPooledBytes are plain QImages. Returned buffers are
+ * kept up to the idle budget; beyond it the oldest are freed.
+ *
+ * A pooled image behaves as any other QImage: copies share it and the
+ * first write to a shared copy detaches to a normal heap image.
+ *
+ * Pattern: Static utility (no instances)
+ */
+class ImageBufferPool
+{
+public:
+    static constexpr int Alignment = 64;
+    static constexpr qint64 MinPooledBytes = 256 * 1024;
+    static constexpr qint64 DefaultIdleBudget = 256 * 1024 * 1024;
+
+    struct Stats
+    {
+        qint64 inUseBytes = 0;      // Held by live images
+        qint64 idleBytes = 0;       // Returned, waiting to be reused
+        qint64 highWaterBytes = 0;  // Peak of in use plus idle
+        qint64 allocations = 0;     // Buffers taken from the heap
+        qint64 reuses = 0;          // Requests served from the pool
+    };
+
+    // Image on a pooled buffer, pixels uninitialized (null for an invalid size or format)
+    static QImage acquire(const QSize &size, QImage::Format format);
+
+    // Deep copy on a pooled buffer, with the color table and metadata of the image
+    static QImage copy(const QImage &image);
+
+    static Stats stats();
+
+    // Bytes of returned buffers kept for reuse
+    static void setIdleBudget(qint64 bytes);
+
+    // Free every idle buffer
+    static void trim();
+
+private:
+    ImageBufferPool() = delete;
+};
+
+#endif // IMAGEBUFFERPOOL_H
@@ -0,0 +1,92 @@
+#include "parallelrows.h"
+#include <QByteArray>
+#include <QThread>
+#include <QThreadPool>
+#include <atomic>
+
+// More bands than threads so uneven rows (e.g. vignette edges) balance out
+static constexpr int BandsPerThread = 4;
+
+static int defaultThreadCount()
+{
+    bool ok = false;
+    const int count = qEnvironmentVariableIntValue("PIX3LFORGE_THREADS", &ok);
+    if (ok && count > 0)
+        return count;
+    return qMax(1, QThread::idealThreadCount());
+}
+
+static std::atomic<int> &configuredThreadCount()
+{
+    static std::atomic<int> count(defaultThreadCount());
+    return count;
+}
+
+static thread_local const std::atomic<bool> *currentCancelFlag = nullptr;
+
+ParallelRows::CancelScope::CancelScope(const std::atomic<bool> *cancelled)
+    : m_previous(currentCancelFlag)
+{
+    currentCancelFlag = cancelled;
+}
+
+ParallelRows::CancelScope::~CancelScope()
+{
+    currentCancelFlag = m_previous;
+}
+
+const std::atomic<bool> *ParallelRows::cancelFlag()
+{
+    return currentCancelFlag;
+}
+
+int ParallelRows::threadCount()
+{
+    return configuredThreadCount().load(std::memory_order_relaxed);
+}
+
+void ParallelRows::setThreadCount(int count)
+{
+    if (count <= 0)
+        count = defaultThreadCount();
+
+    configuredThreadCount().store(count, std::memory_order_relaxed);
+    pool()->setMaxThreadCount(count);
+}
+
+QVector<ParallelRows::Band> ParallelRows::split(int count, int cost)
+{
+    QVector<Band> bands;
+    if (count <= 0)
+        return bands;
+
+    const qint64 pixels = static_cast<qint64>(count) * qMax(1, cost);
+    const qint64 bySize = qMax<qint64>(1, pixels / MinBandPixels);
+    const int threads = threadCount();
+    const int bandCount = threads <= 1
+                          ? 1
+                          : static_cast<int>(qMin<qint64>({bySize, qint64(threads) * BandsPerThread, count}));
+
+    // Spread the remainder over the first bands so sizes differ by at most one row
+    const int base = count / bandCount;
+    const int extra = count % bandCount;
+    bands.reserve(bandCount);
+    int begin = 0;
+    for (int i = 0; i < bandCount; ++i) {
+        const int end = begin + base + (i < extra ? 1 : 0);
+        bands.append({i, begin, end});
+        begin = end;
+    }
+    return bands;
+}
+
+QThreadPool *ParallelRows::pool()
+{
+    // Deliberately leaked so no worker thread is joined during static destruction
+    static QThreadPool *const instance = [] {
+        QThreadPool *threadPool = new QThreadPool;
+        threadPool->setMaxThreadCount(threadCount());
+        return threadPool;
+    }();
+    return instance;
+}
@@ -0,0 +1,109 @@
+#ifndef PARALLELROWS_H
+#define PARALLELROWS_H
+
+#include <QVector>
+#include <atomic>
+#include <QtConcurrent/QtConcurrentMap>
+
+class QThreadPool;
+
+/**
+ * @class ParallelRows
+ * @brief Runs row (or column) range kernels across a thread pool
+ *
+ * An image is split into contiguous bands of rows and each band is handed
+ * to the kernel as a half-open range [begin, end). Kernels must only write
+ * to their own band and must read neighbours (the halo of a neighbourhood
+ * filter) from a source that nobody writes during the run, so the result
+ * is identical to a single-threaded run whatever the thread count or band
+ * layout. Bands that would be too small to amortize the thread hand-off
+ * are merged, so small images and previews run inline on the caller.
+ *
+ * Work runs on a dedicated pool, not QThreadPool::globalInstance(). The
+ * thread count defaults to QThread::idealThreadCount() and can be set with
+ * setThreadCount() or the environment variable PIX3LFORGE_THREADS
+ * (1 disables threading).
+ *
+ * A CancelScope on the calling thread makes runs skip the bands that have
+ * not started once its flag is set, so long operations computed in the
+ * background stop early; their incomplete result must be discarded.
+ *
+ * Pattern: Static utility (no instances)
+ */
+class ParallelRows
+{
+public:
+    // Below this many pixels per band the work stays on one thread
+    static constexpr int MinBandPixels = 64 * 1024;
+
+    struct Band
+    {
+        int index;
+        int begin;
+        int end;
+    };
+
+    // Cancellation flag for the runs started on the current thread while in scope
+    class CancelScope
+    {
+    public:
+        explicit CancelScope(const std::atomic<bool> *cancelled);
+        ~CancelScope();
+
+    private:
+        const std::atomic<bool> *m_previous;
+    };
+
+    static int threadCount();
+
+    // 0 restores the default
+    static void setThreadCount(int count);
+
+    /**
+     * Split rows [0, count) into bands
+     * @param cost Pixels per row (image width), used to size the bands
+     */
+    static QVector<Band> split(int count, int cost);
+
+    /**
+     * Run a kernel on every band and wait for all of them
+     * @param op Callable void(const Band &band)
+     */
+    template <typename BandOp>
+    static void run(QVector<Band> bands, BandOp op)
+    {
+        const std::atomic<bool> *cancelled = cancelFlag();
+        if (bands.size() <= 1) {
+            for (const Band &band : bands) {
+                if (!cancelled || !cancelled->load(std::memory_order_relaxed))
+                    op(band);
+            }
+            return;
+        }
+
+        QtConcurrent::blockingMap(pool(), bands, [&op, cancelled](const Band &band) {
+            if (!cancelled || !cancelled->load(std::memory_order_relaxed))
+                op(band);
+        });
+    }
+
+    /**
+     * Split and run in one call
+     * @param op Callable void(int begin, int end)
+     */
+    template <typename RangeOp>
+    static void forRanges(int count, int cost, RangeOp op)
+    {
+        run(split(count, cost), [&op](const Band &band) {
+            op(band.begin, band.end);
+        });
+    }
+
+private:
+    static QThreadPool *pool();
+    static const std::atomic<bool> *cancelFlag();
+
+    ParallelRows() = delete;
+};
+
+#endif // PARALLELROWS_H
@@ -0,0 +1,50 @@
+#include "pixelkernels.h"
+#include "imagebufferpool.h"
+
+QImage::Format PixelKernels::workingFormat(const QImage &image)
+{
+    return image.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32;
+}
+
+QImage PixelKernels::toWorkingFormat(const QImage &image)
+{
+    const QImage::Format format = workingFormat(image);
+    if (image.format() == format)
+        return ImageBufferPool::copy(image);
+
+    return image.convertToFormat(format);
+}
+
+QImage PixelKernels::toWorkingFormat(QImage &&image)
+{
+    const QImage::Format format = workingFormat(image);
+    if (image.format() == format)
+        return std::move(image);
+
+    return std::move(image).convertToFormat(format);
+}
+
+QImage PixelKernels::workingCopy(const QImage &image)
+{
+    if (image.format() != workingFormat(image))
+        return image;
+
+    return ImageBufferPool::copy(image);
+}
+
+QImage PixelKernels::restoreFormat(const QImage &result, QImage::Format originalFormat)
+{
+    if (result.isNull() || result.format() == originalFormat)
+        return result;
+
+    switch (originalFormat) {
+    case QImage::Format_Invalid:
+    case QImage::Format_Mono:
+    case QImage::Format_MonoLSB:
+    case QImage::Format_Indexed8:
+        // Palette formats cannot hold arbitrary colors, keep the 32-bit result
+        return result;
+    default:
+        return result.convertToFormat(originalFormat);
+    }
+}
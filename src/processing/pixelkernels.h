@@ -0,0 +1,147 @@
+#ifndef PIXELKERNELS_H
+#define PIXELKERNELS_H
+
+#include <QImage>
+#include <QRgb>
+#include "parallelrows.h"
+
+/**
+ * @class PixelKernels
+ * @brief Scanline-based pixel access layer shared by all ImageProcessor operations
+ *
+ * QImage::pixelColor()/setPixelColor() go through a format dispatch and build
+ * a QColor for every single pixel, which dominates the cost of point
+ * operations on large photos. PixelKernels normalizes an image once to a
+ * known 32-bit layout (Format_RGB32 or Format_ARGB32) and hands whole rows
+ * of raw QRgb values to the kernel.
+ *
+ * For the RGB32/ARGB32 images produced by QImageReader the results are
+ * byte-identical to the per-pixel QColor path. Other formats are converted
+ * back to their original format after processing (indexed and mono images
+ * stay in the 32-bit working format, since setPixelColor() never supported them).
+ *
+ * mapRows() and mapPixels() spread the rows over ParallelRows bands, so
+ * their callables must be safe to call concurrently (read-only captures).
+ * Their QImage&& overloads process the image the caller gives up in its
+ * own buffer when that buffer is not shared and already in the working
+ * format, so chained operations do not allocate an image per step.
+ *
+ * Pattern: Static utility (no instances)
+ */
+class PixelKernels
+{
+public:
+    // 32-bit format used for processing: ARGB32 when the image has alpha, RGB32 otherwise
+    static QImage::Format workingFormat(const QImage &image);
+
+    // Detached copy of the image in the working format (on a pooled buffer
+    // when no conversion is needed, see ImageBufferPool)
+    static QImage toWorkingFormat(const QImage &image);
+
+    // The image in the working format, converted in place when possible
+    // (not detached: the first write copies it only if it is shared)
+    static QImage toWorkingFormat(QImage &&image);
+
+    // What a const& overload hands to its && overload: a pooled copy when
+    // the image is already in the working format, otherwise the image
+    // itself (converting it allocates the new buffer anyway)
+    static QImage workingCopy(const QImage &image);
+
+    // Convert a processed working-format image back to the caller's format
+    static QImage restoreFormat(const QImage &result, QImage::Format originalFormat);
+
+    /**
+     * Apply a per-pixel function to a copy of the image
+     * @param op Callable QRgb(QRgb) invoked for every pixel
+     */
+    template <typename PixelOp>
+    static QImage mapPixels(const QImage &image, PixelOp op)
+    {
+        return mapRows(image, pixelRowOp(op));
+    }
+
+    // Same, in the buffer of the image when it is not shared
+    template <typename PixelOp>
+    static QImage mapPixels(QImage &&image, PixelOp op)
+    {
+        return mapRows(std::move(image), pixelRowOp(op));
+    }
+
+    /**
+     * Apply a row function to a copy of the image, rows run in parallel
+     * @param op Callable void(QRgb *line, int y, int width), line is writable
+     */
+    template <typename RowOp>
+    static QImage mapRows(const QImage &image, RowOp op)
+    {
+        if (image.isNull())
+            return image;
+
+        return mapWorkingRows(toWorkingFormat(image), image.format(), op);
+    }
+
+    // Same, in the buffer of the image when it is not shared
+    template <typename RowOp>
+    static QImage mapRows(QImage &&image, RowOp op)
+    {
+        if (image.isNull())
+            return std::move(image);
+
+        const QImage::Format format = image.format();
+        return mapWorkingRows(toWorkingFormat(std::move(image)), format, op);
+    }
+
+    /**
+     * Read-only row traversal (statistics, histograms)
+     * @param op Callable void(const QRgb *line, int y, int width)
+     */
+    template <typename RowOp>
+    static void forEachRow(const QImage &image, RowOp op)
+    {
+        if (image.isNull())
+            return;
+
+        const QImage source = image.format() == workingFormat(image)
+                              ? image
+                              : image.convertToFormat(workingFormat(image));
+        const int width = source.width();
+        const int height = source.height();
+        for (int y = 0; y < height; ++y)
+            op(reinterpret_cast<const QRgb *>(source.constScanLine(y)), y, width);
+    }
+
+    // Clamp an int to the 0-255 channel range
+    static inline int clampChannel(int value)
+    {
+        return value < 0 ? 0 : (value > 255 ? 255 : value);
+    }
+
+private:
+    template <typename PixelOp>
+    static auto pixelRowOp(PixelOp &op)
+    {
+        return [&op](QRgb *line, int, int width) {
+            for (int x = 0; x < width; ++x)
+                line[x] = op(line[x]);
+        };
+    }
+
+    template <typename RowOp>
+    static QImage mapWorkingRows(QImage result, QImage::Format originalFormat, RowOp &op)
+    {
+        const int width = result.width();
+        // Detach once here, scanLine() must not be called from the workers
+        uchar *bits = result.bits();
+        const qsizetype stride = result.bytesPerLine();
+        ParallelRows::forRanges(result.height(), width, [&](int begin, int end) {
+            for (int y = begin; y < end; ++y)
+                op(reinterpret_cast<QRgb *>(bits + y * stride), y, width);
+        });
+
+        return restoreFormat(result, originalFormat);
+    }
+
+    PixelKernels() = delete;
+};
+
+#endif // PIXELKERNELS_H
@@ -0,0 +1,229 @@
+#include "simdkernels.h"
+#include "simdrowkernels.h"
+#include "pixelkernels.h"
+#include <QByteArray>
+#include <QStringList>
+#include <QtMath>
+
+#if defined(PIX3LFORGE_SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Scalar reference kernels, same arithmetic as the original per-pixel loops
+static void brightnessRowScalar(QRgb *line, int width, int brightness)
+{
+    for (int x = 0; x < width; ++x) {
+        const QRgb pixel = line[x];
+        line[x] = qRgba(PixelKernels::clampChannel(qRed(pixel) + brightness),
+                        PixelKernels::clampChannel(qGreen(pixel) + brightness),
+                        PixelKernels::clampChannel(qBlue(pixel) + brightness),
+                        qAlpha(pixel));
+    }
+}
+
+static void affineRowScalar(QRgb *line, int width, double factor, double pivot)
+{
+    for (int x = 0; x < width; ++x) {
+        const QRgb pixel = line[x];
+        line[x] = qRgba(PixelKernels::clampChannel(static_cast<int>(factor * (qRed(pixel) - pivot) + pivot)),
+                        PixelKernels::clampChannel(static_cast<int>(factor * (qGreen(pixel) - pivot) + pivot)),
+                        PixelKernels::clampChannel(static_cast<int>(factor * (qBlue(pixel) - pivot) + pivot)),
+                        qAlpha(pixel));
+    }
+}
+
+static void sepiaRowScalar(QRgb *line, int width)
+{
+    for (int x = 0; x < width; ++x) {
+        const QRgb pixel = line[x];
+        const int red = qRed(pixel);
+        const int green = qGreen(pixel);
+        const int blue = qBlue(pixel);
+        int tr = PixelKernels::clampChannel(static_cast<int>(0.393 * red + 0.769 * green + 0.189 * blue));
+        int tg = PixelKernels::clampChannel(static_cast<int>(0.349 * red + 0.686 * green + 0.168 * blue));
+        int tb = PixelKernels::clampChannel(static_cast<int>(0.272 * red + 0.534 * green + 0.131 * blue));
+        line[x] = qRgba(tr, tg, tb, qAlpha(pixel));
+    }
+}
+
+static void vignetteRowScalar(QRgb *line, int width, int centerX, double dy, double radius)
+{
+    for (int x = 0; x < width; ++x) {
+        double dx = x - centerX;
+        double distance = qSqrt(dx * dx + dy * dy);
+        double factor = qBound(0.0, 1.0 - (distance / radius), 1.0);
+
+        const QRgb pixel = line[x];
+        int r = static_cast<int>(qRed(pixel) * factor);
+        int g = static_cast<int>(qGreen(pixel) * factor);
+        int b = static_cast<int>(qBlue(pixel) * factor);
+        line[x] = qRgba(r, g, b, qAlpha(pixel));
+    }
+}
+
+static void accumulateBytesScalar(int *acc, const uchar *source, int count, int weight)
+{
+    for (int i = 0; i < count; ++i)
+        acc[i] += weight * source[i];
+}
+
+static void accumulateIntsScalar(int *acc, const int *source, int count, int weight)
+{
+    for (int i = 0; i < count; ++i)
+        acc[i] += weight * source[i];
+}
+
+SimdRowKernels SimdRowKernels::scalar()
+{
+    return { brightnessRowScalar, affineRowScalar, sepiaRowScalar, vignetteRowScalar,
+             accumulateBytesScalar, accumulateIntsScalar };
+}
+
+// CPU feature detection
+static SimdKernels::Path detectWidestPath()
+{
+#ifdef PIX3LFORGE_SIMD_X86
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    const bool sse2 = (info[3] & (1 << 26)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    bool avx2 = false;
+    // AVX2 needs the OS to save the YMM registers (XCR0 bits 1 and 2)
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    const bool sse2 = __builtin_cpu_supports("sse2");
+    const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2)
+        return SimdKernels::AVX2;
+    if (sse2)
+        return SimdKernels::SSE2;
+#endif
+    return SimdKernels::Scalar;
+}
+
+static SimdKernels::Path selectedPath()
+{
+    static const SimdKernels::Path path = [] {
+        SimdKernels::Path widest = detectWidestPath();
+
+        const QByteArray cap = qgetenv("PIX3LFORGE_SIMD").toLower();
+        if (cap == "scalar")
+            widest = SimdKernels::Scalar;
+        else if (cap == "sse2" && widest > SimdKernels::SSE2)
+            widest = SimdKernels::SSE2;
+
+        return widest;
+    }();
+    return path;
+}
+
+static const SimdRowKernels &rowKernels()
+{
+    static const SimdRowKernels kernels = [] {
+        switch (selectedPath()) {
+#ifdef PIX3LFORGE_SIMD_X86
+        case SimdKernels::AVX2:
+            return SimdRowKernels::avx2();
+        case SimdKernels::SSE2:
+            return SimdRowKernels::sse2();
+#endif
+        default:
+            return SimdRowKernels::scalar();
+        }
+    }();
+    return kernels;
+}
+
+// SimdKernels
+SimdKernels::Path SimdKernels::path(Operation op)
+{
+    Q_UNUSED(op);
+    // Every operation currently has a kernel for each instruction set
+    return selectedPath();
+}
+
+QString SimdKernels::pathName(Path path)
+{
+    switch (path) {
+    case AVX2:
+        return QStringLiteral("AVX2");
+    case SSE2:
+        return QStringLiteral("SSE2");
+    default:
+        return QStringLiteral("scalar");
+    }
+}
+
+QString SimdKernels::operationName(Operation op)
+{
+    switch (op) {
+    case Brightness:
+        return QStringLiteral("brightness");
+    case Contrast:
+        return QStringLiteral("contrast");
+    case Exposure:
+        return QStringLiteral("exposure");
+    case Sepia:
+        return QStringLiteral("sepia");
+    case Vignette:
+        return QStringLiteral("vignette");
+    case Convolution:
+        return QStringLiteral("convolution");
+    default:
+        return QString();
+    }
+}
+
+QString SimdKernels::report()
+{
+    QStringList entries;
+    for (int op = 0; op < OperationCount; ++op) {
+        const Operation operation = static_cast<Operation>(op);
+        entries << QString("%1=%2").arg(operationName(operation), pathName(path(operation)));
+    }
+    return entries.join(' ');
+}
+
+void SimdKernels::brightnessRow(QRgb *line, int width, int brightness)
+{
+    rowKernels().brightness(line, width, brightness);
+}
+
+void SimdKernels::contrastRow(QRgb *line, int width, double factor)
+{
+    rowKernels().affine(line, width, factor, 128.0);
+}
+
+void SimdKernels::exposureRow(QRgb *line, int width, double factor)
+{
+    rowKernels().affine(line, width, factor, 0.0);
+}
+
+void SimdKernels::sepiaRow(QRgb *line, int width)
+{
+    rowKernels().sepia(line, width);
+}
+
+void SimdKernels::vignetteRow(QRgb *line, int width, int centerX, double dy, double radius)
+{
+    rowKernels().vignette(line, width, centerX, dy, radius);
+}
+
+void SimdKernels::accumulateBytes(int *acc, const uchar *source, int count, int weight)
+{
+    rowKernels().accumulateBytes(acc, source, count, weight);
+}
+
+void SimdKernels::accumulateInts(int *acc, const int *source, int count, int weight)
+{
+    rowKernels().accumulateInts(acc, source, count, weight);
+}
@@ -0,0 +1,66 @@
+#ifndef SIMDKERNELS_H
+#define SIMDKERNELS_H
+
+#include <QRgb>
+#include <QString>
+
+/**
+ * @class SimdKernels
+ * @brief Vectorized scanline kernels with runtime CPU dispatch
+ *
+ * Brightness, contrast, exposure, sepia, vignette and the multiply-add
+ * rows used by Convolution are available as scalar, SSE2 and AVX2 row
+ * kernels. The widest path the CPU (and OS)
+ * supports is picked once on first use. Every path reproduces the scalar
+ * double-precision arithmetic and truncation exactly, so the output does
+ * not depend on the machine.
+ *
+ * The environment variable PIX3LFORGE_SIMD=scalar|sse2|avx2 caps the
+ * path, which is useful for benchmarking and for checking the fallbacks.
+ *
+ * Pattern: Static utility (no instances)
+ */
+class SimdKernels
+{
+public:
+    enum Path {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    enum Operation {
+        Brightness,
+        Contrast,
+        Exposure,
+        Sepia,
+        Vignette,
+        Convolution,
+        OperationCount
+    };
+
+    // Path chosen for an operation on this machine
+    static Path path(Operation op);
+    static QString pathName(Path path);
+    static QString operationName(Operation op);
+
+    // One line per-operation summary, e.g. "brightness=AVX2 contrast=AVX2 ..."
+    static QString report();
+
+    // Row kernels, alpha is preserved
+    static void brightnessRow(QRgb *line, int width, int brightness);
+    static void contrastRow(QRgb *line, int width, double factor);
+    static void exposureRow(QRgb *line, int width, double factor);
+    static void sepiaRow(QRgb *line, int width);
+    static void vignetteRow(QRgb *line, int width, int centerX, double dy, double radius);
+
+    // Convolution taps: acc[i] += weight * source[i]
+    // (accumulateBytes needs -32768 <= weight <= 32767)
+    static void accumulateBytes(int *acc, const uchar *source, int count, int weight);
+    static void accumulateInts(int *acc, const int *source, int count, int weight);
+
+private:
+    SimdKernels() = delete;
+};
+
+#endif // SIMDKERNELS_H
@@ -0,0 +1,145 @@
+#include "simdrowkernels.h"
+
+#ifdef PIX3LFORGE_SIMD_X86
+#include <immintrin.h>
+
+// Built with AVX2 enabled (see CMakeLists.txt), only called after the
+// runtime check in SimdKernels. Four pixels per iteration in double
+// precision (brightness: eight pixels as bytes), same rounding rules as
+// the SSE2 and scalar kernels.
+
+template <int Shift>
+static inline __m256d channel4(__m128i pixels)
+{
+    const __m128i mask = _mm_set1_epi32(0xff);
+    return _mm256_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(pixels, Shift), mask));
+}
+
+static inline __m128i toChannel4(__m256d value)
+{
+    value = _mm256_min_pd(_mm256_max_pd(value, _mm256_setzero_pd()), _mm256_set1_pd(255.0));
+    return _mm256_cvttpd_epi32(value);
+}
+
+static inline __m128i pack4(__m128i pixels, __m128i red, __m128i green, __m128i blue)
+{
+    const __m128i alpha = _mm_and_si128(pixels, _mm_set1_epi32(static_cast<int>(0xff000000)));
+    return _mm_or_si128(_mm_or_si128(alpha, _mm_slli_epi32(red, 16)),
+                        _mm_or_si128(_mm_slli_epi32(green, 8), blue));
+}
+
+static void brightnessRowAvx2(QRgb *line, int width, int brightness)
+{
+    const int amount = brightness < 0 ? -brightness : brightness;
+    const __m256i offset = _mm256_set1_epi32(amount * 0x010101); // RGB lanes only, alpha untouched
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i *p = reinterpret_cast<__m256i *>(line + x);
+        const __m256i pixels = _mm256_loadu_si256(p);
+        _mm256_storeu_si256(p, brightness < 0 ? _mm256_subs_epu8(pixels, offset)
+                                              : _mm256_adds_epu8(pixels, offset));
+    }
+    SimdRowKernels::scalar().brightness(line + x, width - x, brightness);
+}
+
+static void affineRowAvx2(QRgb *line, int width, double factor, double pivot)
+{
+    const __m256d f = _mm256_set1_pd(factor);
+    const __m256d p = _mm256_set1_pd(pivot);
+
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i *ptr = reinterpret_cast<__m128i *>(line + x);
+        const __m128i pixels = _mm_loadu_si128(ptr);
+        const __m128i r = toChannel4(_mm256_add_pd(_mm256_mul_pd(f, _mm256_sub_pd(channel4<16>(pixels), p)), p));
+        const __m128i g = toChannel4(_mm256_add_pd(_mm256_mul_pd(f, _mm256_sub_pd(channel4<8>(pixels), p)), p));
+        const __m128i b = toChannel4(_mm256_add_pd(_mm256_mul_pd(f, _mm256_sub_pd(channel4<0>(pixels), p)), p));
+        _mm_storeu_si128(ptr, pack4(pixels, r, g, b));
+    }
+    SimdRowKernels::scalar().affine(line + x, width - x, factor, pivot);
+}
+
+static inline __m256d dot3(__m256d red, __m256d green, __m256d blue, double cr, double cg, double cb)
+{
+    return _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(cr), red),
+                                       _mm256_mul_pd(_mm256_set1_pd(cg), green)),
+                         _mm256_mul_pd(_mm256_set1_pd(cb), blue));
+}
+
+static void sepiaRowAvx2(QRgb *line, int width)
+{
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i *ptr = reinterpret_cast<__m128i *>(line + x);
+        const __m128i pixels = _mm_loadu_si128(ptr);
+        const __m256d red = channel4<16>(pixels);
+        const __m256d green = channel4<8>(pixels);
+        const __m256d blue = channel4<0>(pixels);
+        const __m128i tr = toChannel4(dot3(red, green, blue, 0.393, 0.769, 0.189));
+        const __m128i tg = toChannel4(dot3(red, green, blue, 0.349, 0.686, 0.168));
+        const __m128i tb = toChannel4(dot3(red, green, blue, 0.272, 0.534, 0.131));
+        _mm_storeu_si128(ptr, pack4(pixels, tr, tg, tb));
+    }
+    SimdRowKernels::scalar().sepia(line + x, width - x);
+}
+
+static void vignetteRowAvx2(QRgb *line, int width, int centerX, double dy, double radius)
+{
+    const __m256d dy2 = _mm256_set1_pd(dy * dy);
+    const __m256d r = _mm256_set1_pd(radius);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d dx = _mm256_set_pd(3.0 - centerX, 2.0 - centerX, 1.0 - centerX, 0.0 - centerX);
+
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        const __m256d distance = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), dy2));
+        const __m256d factor = _mm256_max_pd(zero, _mm256_min_pd(_mm256_sub_pd(one, _mm256_div_pd(distance, r)), one));
+        dx = _mm256_add_pd(dx, _mm256_set1_pd(4.0));
+
+        __m128i *ptr = reinterpret_cast<__m128i *>(line + x);
+        const __m128i pixels = _mm_loadu_si128(ptr);
+        const __m128i red = _mm256_cvttpd_epi32(_mm256_mul_pd(channel4<16>(pixels), factor));
+        const __m128i green = _mm256_cvttpd_epi32(_mm256_mul_pd(channel4<8>(pixels), factor));
+        const __m128i blue = _mm256_cvttpd_epi32(_mm256_mul_pd(channel4<0>(pixels), factor));
+        _mm_storeu_si128(ptr, pack4(pixels, red, green, blue));
+    }
+
+    // Shifting the center keeps the tail's dx values unchanged
+    SimdRowKernels::scalar().vignette(line + x, width - x, centerX - x, dy, radius);
+}
+
+static void accumulateBytesAvx2(int *acc, const uchar *source, int count, int weight)
+{
+    const __m256i w = _mm256_set1_epi32(weight);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i *a = reinterpret_cast<__m256i *>(acc + i);
+        const __m256i values = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(source + i)));
+        _mm256_storeu_si256(a, _mm256_add_epi32(_mm256_loadu_si256(a), _mm256_mullo_epi32(values, w)));
+    }
+    SimdRowKernels::scalar().accumulateBytes(acc + i, source + i, count - i, weight);
+}
+
+static void accumulateIntsAvx2(int *acc, const int *source, int count, int weight)
+{
+    const __m256i w = _mm256_set1_epi32(weight);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i *a = reinterpret_cast<__m256i *>(acc + i);
+        const __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + i));
+        _mm256_storeu_si256(a, _mm256_add_epi32(_mm256_loadu_si256(a), _mm256_mullo_epi32(values, w)));
+    }
+    SimdRowKernels::scalar().accumulateInts(acc + i, source + i, count - i, weight);
+}
+
+SimdRowKernels SimdRowKernels::avx2()
+{
+    return { brightnessRowAvx2, affineRowAvx2, sepiaRowAvx2, vignetteRowAvx2,
+             accumulateBytesAvx2, accumulateIntsAvx2 };
+}
+
+#endif // PIX3LFORGE_SIMD_X86
@@ -0,0 +1,162 @@
+#include "simdrowkernels.h"
+
+#ifdef PIX3LFORGE_SIMD_X86
+#include <emmintrin.h>
+
+// Two pixels per iteration in double precision (brightness: four pixels as bytes).
+// Clamping to 0..255 before truncation gives the same result as the scalar
+// truncate-then-clamp, so the output is bit-identical.
+
+template <int Shift>
+static inline __m128d channel2(__m128i pixels)
+{
+    const __m128i mask = _mm_set1_epi32(0xff);
+    return _mm_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(pixels, Shift), mask));
+}
+
+static inline __m128i toChannel2(__m128d value)
+{
+    value = _mm_min_pd(_mm_max_pd(value, _mm_setzero_pd()), _mm_set1_pd(255.0));
+    return _mm_cvttpd_epi32(value);
+}
+
+static inline __m128i pack2(__m128i pixels, __m128i red, __m128i green, __m128i blue)
+{
+    const __m128i alpha = _mm_and_si128(pixels, _mm_set1_epi32(static_cast<int>(0xff000000)));
+    return _mm_or_si128(_mm_or_si128(alpha, _mm_slli_epi32(red, 16)),
+                        _mm_or_si128(_mm_slli_epi32(green, 8), blue));
+}
+
+static void brightnessRowSse2(QRgb *line, int width, int brightness)
+{
+    const int amount = brightness < 0 ? -brightness : brightness;
+    const __m128i offset = _mm_set1_epi32(amount * 0x010101); // RGB lanes only, alpha untouched
+
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i *p = reinterpret_cast<__m128i *>(line + x);
+        const __m128i pixels = _mm_loadu_si128(p);
+        _mm_storeu_si128(p, brightness < 0 ? _mm_subs_epu8(pixels, offset)
+                                           : _mm_adds_epu8(pixels, offset));
+    }
+    SimdRowKernels::scalar().brightness(line + x, width - x, brightness);
+}
+
+static void affineRowSse2(QRgb *line, int width, double factor, double pivot)
+{
+    const __m128d f = _mm_set1_pd(factor);
+    const __m128d p = _mm_set1_pd(pivot);
+
+    int x = 0;
+    for (; x + 2 <= width; x += 2) {
+        __m128i *ptr = reinterpret_cast<__m128i *>(line + x);
+        const __m128i pixels = _mm_loadl_epi64(ptr);
+        const __m128i r = toChannel2(_mm_add_pd(_mm_mul_pd(f, _mm_sub_pd(channel2<16>(pixels), p)), p));
+        const __m128i g = toChannel2(_mm_add_pd(_mm_mul_pd(f, _mm_sub_pd(channel2<8>(pixels), p)), p));
+        const __m128i b = toChannel2(_mm_add_pd(_mm_mul_pd(f, _mm_sub_pd(channel2<0>(pixels), p)), p));
+        _mm_storel_epi64(ptr, pack2(pixels, r, g, b));
+    }
+    SimdRowKernels::scalar().affine(line + x, width - x, factor, pivot);
+}
+
+static inline __m128d dot3(__m128d red, __m128d green, __m128d blue, double cr, double cg, double cb)
+{
+    return _mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_set1_pd(cr), red), _mm_mul_pd(_mm_set1_pd(cg), green)),
+                      _mm_mul_pd(_mm_set1_pd(cb), blue));
+}
+
+static void sepiaRowSse2(QRgb *line, int width)
+{
+    int x = 0;
+    for (; x + 2 <= width; x += 2) {
+        __m128i *ptr = reinterpret_cast<__m128i *>(line + x);
+        const __m128i pixels = _mm_loadl_epi64(ptr);
+        const __m128d red = channel2<16>(pixels);
+        const __m128d green = channel2<8>(pixels);
+        const __m128d blue = channel2<0>(pixels);
+        const __m128i tr = toChannel2(dot3(red, green, blue, 0.393, 0.769, 0.189));
+        const __m128i tg = toChannel2(dot3(red, green, blue, 0.349, 0.686, 0.168));
+        const __m128i tb = toChannel2(dot3(red, green, blue, 0.272, 0.534, 0.131));
+        _mm_storel_epi64(ptr, pack2(pixels, tr, tg, tb));
+    }
+    SimdRowKernels::scalar().sepia(line + x, width - x);
+}
+
+static void vignetteRowSse2(QRgb *line, int width, int centerX, double dy, double radius)
+{
+    const __m128d dy2 = _mm_set1_pd(dy * dy);
+    const __m128d r = _mm_set1_pd(radius);
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d zero = _mm_setzero_pd();
+    __m128d dx = _mm_set_pd(1.0 - centerX, 0.0 - centerX);
+
+    int x = 0;
+    for (; x + 2 <= width; x += 2) {
+        const __m128d distance = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(dx, dx), dy2));
+        const __m128d factor = _mm_max_pd(zero, _mm_min_pd(_mm_sub_pd(one, _mm_div_pd(distance, r)), one));
+        dx = _mm_add_pd(dx, _mm_set1_pd(2.0));
+
+        __m128i *ptr = reinterpret_cast<__m128i *>(line + x);
+        const __m128i pixels = _mm_loadl_epi64(ptr);
+        const __m128i red = _mm_cvttpd_epi32(_mm_mul_pd(channel2<16>(pixels), factor));
+        const __m128i green = _mm_cvttpd_epi32(_mm_mul_pd(channel2<8>(pixels), factor));
+        const __m128i blue = _mm_cvttpd_epi32(_mm_mul_pd(channel2<0>(pixels), factor));
+        _mm_storel_epi64(ptr, pack2(pixels, red, green, blue));
+    }
+
+    // Shifting the center keeps the tail's dx values unchanged
+    SimdRowKernels::scalar().vignette(line + x, width - x, centerX - x, dy, radius);
+}
+
+// Sixteen bytes per iteration: widened to 16 bits, multiplied into
+// 32-bit products from the low and high halves of each 16-bit product
+static void accumulateBytesSse2(int *acc, const uchar *source, int count, int weight)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i w = _mm_set1_epi16(static_cast<short>(weight));
+
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+        const __m128i halves[2] = { _mm_unpacklo_epi8(bytes, zero), _mm_unpackhi_epi8(bytes, zero) };
+
+        __m128i *a = reinterpret_cast<__m128i *>(acc + i);
+        for (int h = 0; h < 2; ++h) {
+            const __m128i low = _mm_mullo_epi16(halves[h], w);
+            const __m128i high = _mm_mulhi_epi16(halves[h], w);
+            _mm_storeu_si128(a + 2 * h, _mm_add_epi32(_mm_loadu_si128(a + 2 * h), _mm_unpacklo_epi16(low, high)));
+            _mm_storeu_si128(a + 2 * h + 1, _mm_add_epi32(_mm_loadu_si128(a + 2 * h + 1), _mm_unpackhi_epi16(low, high)));
+        }
+    }
+    SimdRowKernels::scalar().accumulateBytes(acc + i, source + i, count - i, weight);
+}
+
+// SSE2 has no 32-bit mullo: multiply even and odd lanes, keep the low halves
+static inline __m128i mullo32(__m128i a, __m128i b)
+{
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static void accumulateIntsSse2(int *acc, const int *source, int count, int weight)
+{
+    const __m128i w = _mm_set1_epi32(weight);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i *a = reinterpret_cast<__m128i *>(acc + i);
+        const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+        _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), mullo32(values, w)));
+    }
+    SimdRowKernels::scalar().accumulateInts(acc + i, source + i, count - i, weight);
+}
+
+SimdRowKernels SimdRowKernels::sse2()
+{
+    return { brightnessRowSse2, affineRowSse2, sepiaRowSse2, vignetteRowSse2,
+             accumulateBytesSse2, accumulateIntsSse2 };
+}
+
+#endif // PIX3LFORGE_SIMD_X86
@@ -0,0 +1,32 @@
+#ifndef SIMDROWKERNELS_H
+#define SIMDROWKERNELS_H
+
+#include <QRgb>
+#include <QtGlobal>
+
+// Internal to SimdKernels: one table of row functions per instruction set
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PIX3LFORGE_SIMD_X86
+#endif
+
+struct SimdRowKernels
+{
+    void (*brightness)(QRgb *line, int width, int brightness);
+    // Per channel: clamp(int(factor * (value - pivot) + pivot))
+    void (*affine)(QRgb *line, int width, double factor, double pivot);
+    void (*sepia)(QRgb *line, int width);
+    void (*vignette)(QRgb *line, int width, int centerX, double dy, double radius);
+    // acc[i] += weight * source[i], weight fits in 16 bits
+    void (*accumulateBytes)(int *acc, const uchar *source, int count, int weight);
+    // acc[i] += weight * source[i] (32-bit wrap-around, callers keep sums in range)
+    void (*accumulateInts)(int *acc, const int *source, int count, int weight);
+
+    static SimdRowKernels scalar();
+#ifdef PIX3LFORGE_SIMD_X86
+    static SimdRowKernels sse2();  // simdkernels_sse2.cpp
+    static SimdRowKernels avx2();  // simdkernels_avx2.cpp, built with AVX2 enabled
+#endif
+};
+
+#endif // SIMDROWKERNELS_H
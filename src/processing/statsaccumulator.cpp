@@ -0,0 +1,109 @@
+#include "statsaccumulator.h"
+#include "pixelkernels.h"
+#include "parallelrows.h"
+#include "exacthsv.h"
+#include <QVector>
+#include <QtMath>
+
+StatsAccumulator::StatsAccumulator()
+    : m_count(0)
+    , m_lumaSum(0)
+    , m_squaresLow(0)
+    , m_squaresHigh(0)
+    , m_saturationSum(0)
+    , m_dark(0)
+    , m_bright(0)
+{
+}
+
+StatsAccumulator StatsAccumulator::scan(const QImage &image)
+{
+    StatsAccumulator total;
+    if (image.isNull())
+        return total;
+
+    const QImage::Format format = PixelKernels::workingFormat(image);
+    const QImage source = image.format() == format ? image : image.convertToFormat(format);
+    const int width = source.width();
+
+    const QVector<ParallelRows::Band> bands = ParallelRows::split(source.height(), width);
+    QVector<StatsAccumulator> partials(bands.size());
+    StatsAccumulator *partialData = partials.data();
+    ParallelRows::run(bands, [&](const ParallelRows::Band &band) {
+        StatsAccumulator &partial = partialData[band.index];
+        for (int y = band.begin; y < band.end; ++y)
+            partial.addRow(reinterpret_cast<const QRgb *>(source.constScanLine(y)), width);
+    });
+
+    for (const StatsAccumulator &partial : partials)
+        total.merge(partial);
+    return total;
+}
+
+void StatsAccumulator::addRow(const QRgb *line, int width)
+{
+    // Per-row sums fit in 64 bits (luma^2 < 2^36), carried into 128 bits once per row
+    quint64 lumaSum = 0;
+    quint64 squares = 0;
+    quint64 saturationSum = 0;
+    qint64 dark = 0;
+    qint64 bright = 0;
+
+    for (int x = 0; x < width; ++x) {
+        const QRgb pixel = line[x];
+        const quint64 luma = 299 * qRed(pixel) + 587 * qGreen(pixel) + 114 * qBlue(pixel);
+        lumaSum += luma;
+        squares += luma * luma;
+        dark += luma < DarkLimit * 1000;
+        bright += luma > BrightLimit * 1000;
+        saturationSum += ExactHsv::saturation16(pixel);
+    }
+
+    m_count += width;
+    m_lumaSum += lumaSum;
+    addSquares(squares);
+    m_saturationSum += saturationSum;
+    m_dark += dark;
+    m_bright += bright;
+}
+
+void StatsAccumulator::merge(const StatsAccumulator &other)
+{
+    m_count += other.m_count;
+    m_lumaSum += other.m_lumaSum;
+    addSquares(other.m_squaresLow);
+    m_squaresHigh += other.m_squaresHigh;
+    m_saturationSum += other.m_saturationSum;
+    m_dark += other.m_dark;
+    m_bright += other.m_bright;
+}
+
+double StatsAccumulator::meanBrightness() const
+{
+    return m_count > 0 ? m_lumaSum / 1000.0 / m_count : 0.0;
+}
+
+double StatsAccumulator::brightnessDeviation() const
+{
+    if (m_count == 0)
+        return 0.0;
+
+    // E[L^2] - E[L]^2 in thousandths squared; inputs are exact integers
+    const double squares = m_squaresHigh * 18446744073709551616.0 + m_squaresLow;
+    const double mean = static_cast<double>(m_lumaSum) / m_count;
+    const double variance = squares / m_count - mean * mean;
+    return variance > 0.0 ? qSqrt(variance) / 1000.0 : 0.0;
+}
+
+double StatsAccumulator::meanSaturation() const
+{
+    return m_count > 0 ? m_saturationSum / 65535.0 / m_count : 0.0;
+}
+
+void StatsAccumulator::addSquares(quint64 squares)
+{
+    const quint64 previous = m_squaresLow;
+    m_squaresLow += squares;
+    if (m_squaresLow < previous)
+        ++m_squaresHigh;
+}
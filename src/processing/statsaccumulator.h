@@ -0,0 +1,58 @@
+#ifndef STATSACCUMULATOR_H
+#define STATSACCUMULATOR_H
+
+#include <QImage>
+#include <QRgb>
+
+/**
+ * @class StatsAccumulator
+ * @brief Streaming brightness/saturation statistics in constant memory
+ *
+ * Brightness is the Rec. 601 luma 0.299 R + 0.587 G + 0.114 B, kept as
+ * the exact integer 299 R + 587 G + 114 B (thousandths). Count, sum, sum
+ * of squares (128 bits), 16-bit HSV saturation sum and the dark/bright
+ * counters are all integers, so partial results from any split of the
+ * image merge to exactly the same totals, and mean and variance come out
+ * of a single pass without storing per-pixel values.
+ *
+ * scan() runs one accumulator per ParallelRows band and merges them.
+ */
+class StatsAccumulator
+{
+public:
+    // Luma thresholds of the dark (< 64) and bright (> 192) pixel counts
+    static constexpr int DarkLimit = 64;
+    static constexpr int BrightLimit = 192;
+
+    StatsAccumulator();
+
+    // Statistics of a whole image, rows scanned in parallel
+    static StatsAccumulator scan(const QImage &image);
+
+    void addRow(const QRgb *line, int width);
+    void merge(const StatsAccumulator &other);
+
+    qint64 pixelCount() const { return m_count; }
+    qint64 darkPixels() const { return m_dark; }
+    qint64 brightPixels() const { return m_bright; }
+
+    // 0-255
+    double meanBrightness() const;
+    // Population standard deviation of the brightness
+    double brightnessDeviation() const;
+    // 0-1
+    double meanSaturation() const;
+
+private:
+    void addSquares(quint64 squares);
+
+    qint64 m_count;
+    quint64 m_lumaSum;
+    quint64 m_squaresLow;
+    quint64 m_squaresHigh;
+    quint64 m_saturationSum;
+    qint64 m_dark;
+    qint64 m_bright;
+};
+
+#endif // STATSACCUMULATOR_H
@@ -92,6 +92,27 @@ void SettingsManager::setWindowState(const QByteArray &state)
     m_settings->setValue("windowState", state);
 }
 
+bool SettingsManager::colorLutPreview() const
+{
+    return m_settings->value("Preview/colorLut", false).toBool();
+}
+
+void SettingsManager::setColorLutPreview(bool enabled)
+{
+    m_settings->setValue("Preview/colorLut", enabled);
+}
+
+qint64 SettingsManager::undoMemoryBudget() const
+{
+    const qint64 megabytes = m_settings->value("History/undoMemoryMB", DefaultUndoMemoryMB).toLongLong();
+    return qMax<qint64>(megabytes, 1) * 1024 * 1024;
+}
+
+void SettingsManager::setUndoMemoryBudget(qint64 bytes)
+{
+    m_settings->setValue("History/undoMemoryMB", bytes / (1024 * 1024));
+}
+
 AIProviderConfig SettingsManager::getAIProviderConfig() const
 {
     IAIProvider::ProviderType providerType = static_cast<IAIProvider::ProviderType>(
@@ -34,6 +34,15 @@ public:
     QByteArray windowState() const;
     void setWindowState(const QByteArray &state);
 
+    // Preview settings
+    bool colorLutPreview() const;
+    void setColorLutPreview(bool enabled);
+
+    // Undo history memory budget in bytes, older history is spilled to disk
+    qint64 undoMemoryBudget() const;
+    void setUndoMemoryBudget(qint64 bytes);
+    static constexpr int DefaultUndoMemoryMB = 1024;
+
     // AI Configuration methods
     AIProviderConfig getAIProviderConfig() const;
     void setAIProviderConfig(const AIProviderConfig& config);
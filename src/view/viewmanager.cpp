@@ -19,12 +19,35 @@ void ViewManager::displayImage(const QImage &image)
     if (image.isNull())
         return;
 
+    m_imageSize = image.size();
     m_imageLabel->setPixmap(QPixmap::fromImage(image));
     m_imageLabel->adjustSize();
 
     updateZoomLimits();
 }
 
+void ViewManager::displayPreview(const QImage &preview)
+{
+    if (preview.isNull())
+        return;
+
+    // Scaled contents: the label keeps its size and stretches the frame
+    m_imageLabel->setPixmap(QPixmap::fromImage(preview));
+}
+
+QSize ViewManager::previewSize() const
+{
+    if (m_imageSize.isEmpty())
+        return QSize();
+
+    // The label may not have been laid out yet after switching to fit mode
+    const QSize shown = m_fitToWindow ? m_scrollArea->viewport()->size()
+                                      : m_imageSize * m_scaleFactor;
+    const QSize device = shown * m_imageLabel->devicePixelRatioF();
+
+    return device.expandedTo(QSize(1, 1)).boundedTo(m_imageSize);
+}
+
 void ViewManager::zoomIn()
 {
     scaleImage(1.25);
@@ -37,7 +60,7 @@ void ViewManager::zoomOut()
 
 void ViewManager::normalSize()
 {
-    m_imageLabel->adjustSize();
+    m_imageLabel->resize(m_imageSize);
     m_scaleFactor = 1.0;
 
     emit scaleFactorChanged(m_scaleFactor);
@@ -78,11 +101,11 @@ void ViewManager::reset()
 
 void ViewManager::scaleImage(double factor)
 {
-    if (m_imageLabel->pixmap().isNull())
+    if (m_imageSize.isEmpty())
         return;
 
     m_scaleFactor *= factor;
-    m_imageLabel->resize(m_scaleFactor * m_imageLabel->pixmap().size());
+    m_imageLabel->resize(m_scaleFactor * m_imageSize);
 
     adjustScrollBar(m_scrollArea->horizontalScrollBar(), factor);
     adjustScrollBar(m_scrollArea->verticalScrollBar(), factor);
@@ -2,6 +2,7 @@
 #define VIEWMANAGER_H
 
 #include <QObject>
+#include <QSize>
 
 class QLabel;
 class QScrollArea;
@@ -20,6 +21,7 @@ class QImage;
  * - Handle zoom operations (in, out, fit to window, normal size)
  * - Manage scroll position during zoom
  * - Track current scale factor
+ * - Report the on-screen size live previews are rendered at
  *
  * Benefits:
  * - Separates view logic from business logic
@@ -37,6 +39,19 @@ public:
     // Display an image
     void displayImage(const QImage &image);
 
+    /**
+     * Show a frame of the displayed image without changing the view
+     * The frame may be smaller than the image, it is stretched over the
+     * label like any zoomed image.
+     */
+    void displayPreview(const QImage &preview);
+
+    /**
+     * Size the displayed image covers on screen, in device pixels,
+     * never larger than the image (invalid when nothing is displayed)
+     */
+    QSize previewSize() const;
+
     // Zoom operations
     void zoomIn();
     void zoomOut();
@@ -72,6 +87,7 @@ private:
 
     QLabel *m_imageLabel;
     QScrollArea *m_scrollArea;
+    QSize m_imageSize;  // Of the displayed image, previews may be smaller
     double m_scaleFactor;
     bool m_fitToWindow;
 };